@@ -0,0 +1,166 @@
+#ifndef __BCM_H__
+#define __BCM_H__
+
+#include <stm8s.h>
+#include <osconfig.h>
+#include <tim.h>
+
+// binary code modulation of up to 16 pins on several ports (LED arrays)
+// every channel has an 8-bit brightness; the frame is split into 8 periods of
+// 1, 2, 4 ... 128 units and during period b each pin shows bit b of its value
+// the pin levels of every period are precomputed per port (bit planes) when a
+// brightness is set, so the update interrupt only writes one ODR per port and
+// preloads the auto-reload register with the length of the next period
+// the update interrupt of the lowest period must fit in BCM_UNIT timer counts
+//
+// usage:
+//   static GPIO_TypeDef * const ports[] = { GPIOC, GPIOD };
+//   static const bcm_ch_t leds[] = { { 0, 0x02 }, { 0, 0x04 }, { 1, 0x01 } };
+//   BCM(bcm, ports, leds);
+//   INTERRUPT_HANDLER(TIM2_UPD_OVF_BRK_IRQHandler, 13) { bcm_handler(bcm); }
+//   ...
+//   bcm_start(bcm);
+//   bcm_set(bcm, 2, 64);
+
+#ifndef BCM_TIM
+#define BCM_TIM          2    // timebase timer (2 or 3)
+#endif
+
+#define TIM_CLAIM BCM_TIM
+#include <tim.h>
+#define BCM_TIMER        TIM_REG(BCM_TIM)
+#ifndef BCM_UNIT
+#define BCM_UNIT         16   // timer counts of the lowest period (16 us), frame of 255 units (245 Hz)
+#endif
+#ifndef BCM_ACTIVE_LOW
+#define BCM_ACTIVE_LOW   1    // pin low turns the LED on (as led.h)
+#endif
+
+#define BCM_PSC          4    // timer counts at CPU_FREQUENCY / 16, 1 MHz on the discovery board
+#define BCM_BITS         8
+
+#if (BCM_UNIT) * 128 > 0xFFFF
+#error Incorrect BCM_UNIT!
+#endif
+
+/* -------------------------------------------------------------------------- */
+
+typedef struct __bcm_ch
+{
+	uint8_t port;  // index in the port table
+	uint8_t mask;  // pin mask
+}	bcm_ch_t;
+
+typedef struct __bcm
+{
+	GPIO_TypeDef * const *port;
+	const bcm_ch_t       *ch;
+	uint8_t               ports;
+	uint8_t               chs;
+	uint8_t               bit;   // period being shown
+	uint8_t              *pins;  // driven pins of every port
+	uint8_t              *plane; // [BCM_BITS][ports] pin levels of every period
+}	bcm_t, *bcm_id;
+
+/* -------------------------------------------------------------------------- */
+
+#define BCM_COUNT( table ) (sizeof(table) / sizeof(*(table)))
+
+#define _BCM_INIT( ports, chs, pins, plane ) \
+        { ports, chs, BCM_COUNT(ports), BCM_COUNT(chs), 0, pins, plane }
+
+// define engine (bcm) driving the channels of array (chs) on the ports of array (ports)
+#define             BCM( bcm, ports, chs )                                                     \
+                    uint8_t bcm##__pins[BCM_COUNT(ports)];                                     \
+                    uint8_t bcm##__plane[BCM_BITS * BCM_COUNT(ports)];                         \
+                    bcm_t bcm##__bcm = _BCM_INIT( ports, chs, bcm##__pins, bcm##__plane );     \
+                    bcm_id bcm = & bcm##__bcm
+
+#define      static_BCM( bcm, ports, chs )                                                     \
+             static uint8_t bcm##__pins[BCM_COUNT(ports)];                                     \
+             static uint8_t bcm##__plane[BCM_BITS * BCM_COUNT(ports)];                         \
+             static bcm_t bcm##__bcm = _BCM_INIT( ports, chs, bcm##__pins, bcm##__plane );     \
+             static bcm_id bcm = & bcm##__bcm
+
+/* -------------------------------------------------------------------------- */
+
+static inline void bcm_arr( uint8_t bit )
+{
+	uint16_t arr = ((uint16_t)(BCM_UNIT) << bit) - 1;
+	BCM_TIMER->ARRH = (uint8_t)(arr >> 8);
+	BCM_TIMER->ARRL = (uint8_t)(arr);
+}
+
+// set brightness of channel (ch), 0 (off) .. 255 (on)
+static inline void bcm_set( bcm_id bcm, uint8_t ch, uint8_t val )
+{
+	const bcm_ch_t *c = &bcm->ch[ch];
+	uint8_t *pl = bcm->plane + c->port;
+	uint8_t b;
+
+	if (BCM_ACTIVE_LOW) val = (uint8_t)~val;
+	for (b = 0; b < BCM_BITS; b++, pl += bcm->ports, val >>= 1)
+	{
+		if (val & 1) *pl |= c->mask;
+		else         *pl &= (uint8_t)~c->mask;
+	}
+}
+
+// configure the pins (push-pull outputs, off) and start the timer
+static inline void bcm_start( bcm_id bcm )
+{
+	uint8_t i;
+
+	for (i = 0; i < bcm->ports; i++)
+		bcm->pins[i] = 0;
+	for (i = 0; i < bcm->chs; i++)
+	{
+		GPIO_TypeDef *gpio = bcm->port[bcm->ch[i].port];
+		bcm->pins[bcm->ch[i].port] |= bcm->ch[i].mask;
+		bcm_set(bcm, i, 0);
+		if (BCM_ACTIVE_LOW) gpio->ODR |= bcm->ch[i].mask;
+		else                gpio->ODR &= (uint8_t)~bcm->ch[i].mask;
+		gpio->DDR |= bcm->ch[i].mask;
+		gpio->CR1 |= bcm->ch[i].mask;
+	}
+	bcm->bit = 0;
+
+	BCM_TIMER->PSCR  = BCM_PSC;
+	bcm_arr(0);
+	BCM_TIMER->EGR   = TIM2_EGR_UG;  // a short blank period first
+	BCM_TIMER->CR1  |= TIM2_CR1_ARPE;
+	bcm_arr(0);                    // preload the length of period 0
+	BCM_TIMER->SR1   = (uint8_t)~TIM2_SR1_UIF;
+	BCM_TIMER->IER  |= TIM2_IER_UIE;
+	BCM_TIMER->CR1  |= TIM2_CR1_CEN;
+}
+
+static inline void bcm_stop( bcm_id bcm )
+{
+	(void) bcm;
+	BCM_TIMER->CR1 &= (uint8_t)~TIM2_CR1_CEN;
+	BCM_TIMER->IER &= (uint8_t)~TIM2_IER_UIE;
+}
+
+// call from the update interrupt handler of BCM_TIM
+// period (bit), whose length was preloaded by the previous call, has just
+// started: show its plane and preload the length of the next period
+static inline void bcm_handler( bcm_id bcm )
+{
+	const uint8_t *pl = bcm->plane + bcm->bit * bcm->ports;
+	GPIO_TypeDef * const *port = bcm->port;
+	const uint8_t *pins = bcm->pins;
+	uint8_t i;
+
+	BCM_TIMER->SR1 = (uint8_t)~TIM2_SR1_UIF;
+
+	for (i = bcm->ports; i; i--, port++, pins++, pl++)
+		(*port)->ODR = (uint8_t)(((*port)->ODR & ~*pins) | *pl);
+
+	bcm->bit = (bcm->bit + 1) & (BCM_BITS - 1);
+	bcm_arr(bcm->bit);
+}
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__BCM_H__
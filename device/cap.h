@@ -0,0 +1,241 @@
+#ifndef __CAP_H__
+#define __CAP_H__
+
+#include <os.h>
+#include <irq.h>
+#include <tim.h>
+
+// input capture time stamps on TIM1 (CH1..CH4: PC1..PC4)
+// TIM1 runs freely at CPU_FREQUENCY / (CAP_PSC + 1), 62.5 ns per count at
+// 16 MHz, and the update interrupt extends the counter to 32 bits (a wrap
+// every 4.3 minutes); the capture handler reads the counter to resolve the
+// overflow / capture race both ways: an overflow still pending (UIF set,
+// counter in the low half) is added to the high word, and a capture value
+// above the counter was taken before the last overflow
+// every channel keeps the last period (period mode) and the number of edges
+// and the time span since the last query (frequency mode, reciprocal
+// counting); channels selected for queueing also push every time stamp to
+// a queue read by tasks, the semaphore is given when the queue gets an entry
+// the handlers must not be delayed by more than half a counter period (2 ms)
+//
+// usage:
+//   CAP();
+//   INTERRUPT_HANDLER(TIM1_UPD_OVF_TRG_BRK_IRQHandler, 11) { cap_ovfHandler(); }
+//   INTERRUPT_HANDLER(TIM1_CAP_COM_IRQHandler, 12) { cap_handler(); }
+//   OS_SEM(edge, 0, semBinary);
+//   ...
+//   cap_init(0x01, 0x00, 0x01, edge);     // CH1, rising edges, queued
+//   while (cap_get(&evt)) ...             // or cap_period(0), cap_frequency(0)
+
+#ifndef CAP_PSC
+#define CAP_PSC          0    // timer counts at CPU_FREQUENCY / (CAP_PSC + 1)
+#endif
+#ifndef CAP_FILTER
+#define CAP_FILTER       0    // input filter (ICxF)
+#endif
+#ifndef CAP_QUEUE
+#define CAP_QUEUE        16   // time stamps queued to tasks, power of two
+#endif
+
+#define CAP_CLOCK      ((CPU_FREQUENCY) / ((CAP_PSC) + 1))
+
+#define TIM_CLAIM 1
+#include <tim.h>
+
+/* -------------------------------------------------------------------------- */
+
+typedef struct __cap_evt
+{
+	uint8_t  ch;    // channel 0..3
+	uint32_t time;  // in timer counts
+}	cap_evt_t;
+
+typedef struct __cap_ch
+{
+	uint32_t last;   // last time stamp
+	uint32_t period; // between the last two edges
+	uint32_t first;  // first time stamp of the frequency window
+	uint16_t edges;  // edges in the frequency window (saturates)
+}	cap_ch_t;
+
+typedef struct __cap
+{
+	volatile uint16_t hi;     // high word of the counter
+	uint8_t           queue;  // channels pushing time stamps to the queue
+	volatile uint8_t  head;
+	volatile uint8_t  tail;
+	uint8_t           lost;   // time stamps dropped or overcaptured (saturates)
+	sem_id            sem;
+	cap_ch_t          ch[4];
+	cap_evt_t         evt[CAP_QUEUE];
+}	cap_t;
+
+extern cap_t cap;
+
+// define the state of the service
+#define CAP()   cap_t cap
+
+/* -------------------------------------------------------------------------- */
+
+// start capturing on the channels of (chs) (bit 0: CH1 ...), on falling edges
+// for the channels of (falling), rising otherwise; time stamps of the channels
+// of (queue) are queued and (sem) is given when the queue gets an entry
+static inline void cap_init( uint8_t chs, uint8_t falling, uint8_t queue, sem_id sem )
+{
+	uint8_t i;
+
+	cap.hi    = 0;
+	cap.queue = queue;
+	cap.head  = 0;
+	cap.tail  = 0;
+	cap.lost  = 0;
+	cap.sem   = sem;
+	for (i = 0; i < 4; i++)
+	{
+		cap.ch[i].edges  = 0;
+		cap.ch[i].period = 0;
+	}
+
+	TIM1->PSCRH = (uint8_t)((CAP_PSC) >> 8);
+	TIM1->PSCRL = (uint8_t)(CAP_PSC);
+	TIM1->ARRH  = 0xFF;
+	TIM1->ARRL  = 0xFF;
+	TIM1->CCMR1 = (uint8_t)((CAP_FILTER) << 4) | 1; // CCxS = 01: ICx on TIx
+	TIM1->CCMR2 = (uint8_t)((CAP_FILTER) << 4) | 1;
+	TIM1->CCMR3 = (uint8_t)((CAP_FILTER) << 4) | 1;
+	TIM1->CCMR4 = (uint8_t)((CAP_FILTER) << 4) | 1;
+	TIM1->CCER1 = (uint8_t)(((chs & 1) ? TIM1_CCER1_CC1E | ((falling & 1) ? TIM1_CCER1_CC1P : 0) : 0) |
+	                        ((chs & 2) ? TIM1_CCER1_CC2E | ((falling & 2) ? TIM1_CCER1_CC2P : 0) : 0));
+	TIM1->CCER2 = (uint8_t)(((chs & 4) ? TIM1_CCER2_CC3E | ((falling & 4) ? TIM1_CCER2_CC3P : 0) : 0) |
+	                        ((chs & 8) ? TIM1_CCER2_CC4E | ((falling & 8) ? TIM1_CCER2_CC4P : 0) : 0));
+	TIM1->EGR   = TIM1_EGR_UG;
+	TIM1->SR1   = 0;
+	TIM1->SR2   = 0;
+	TIM1->IER   = TIM1_IER_UIE | (uint8_t)((chs & 0x0F) << 1);
+	TIM1->CR1   = TIM1_CR1_URS | TIM1_CR1_CEN;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static inline uint16_t cap_counter( void )
+{
+	uint8_t h = TIM1->CNTRH; // reading CNTRH latches CNTRL
+	return ((uint16_t)h << 8) | TIM1->CNTRL;
+}
+
+// call from TIM1_UPD_OVF_TRG_BRK_IRQHandler
+static inline void cap_ovfHandler( void )
+{
+	TIM1->SR1 = (uint8_t)~TIM1_SR1_UIF;
+	cap.hi++;
+}
+
+static inline void cap_edge( uint8_t i, uint32_t t )
+{
+	cap_ch_t *c = &cap.ch[i];
+	uint8_t head;
+
+	if (c->edges) c->period = t - c->last;
+	else          c->first  = t;
+	c->last = t;
+	if (c->edges < 0xFFFF) c->edges++;
+
+	if ((cap.queue & (1 << i)) == 0)
+		return;
+
+	head = cap.head;
+	if ((uint8_t)(head - cap.tail) == CAP_QUEUE)
+	{
+		if (cap.lost < 0xFF) cap.lost++;
+		return;
+	}
+	cap.evt[head & (CAP_QUEUE - 1)].ch   = i;
+	cap.evt[head & (CAP_QUEUE - 1)].time = t;
+	cap.head = head + 1;
+	if (head == cap.tail && cap.sem) sem_give(cap.sem);
+}
+
+// call from TIM1_CAP_COM_IRQHandler
+static inline void cap_handler( void )
+{
+	volatile uint8_t *ccr = &TIM1->CCR1H;
+	uint8_t sr = TIM1->SR1;
+	uint8_t i;
+
+	if ((TIM1->SR2 & 0x1E) && cap.lost < 0xFF)
+		cap.lost++;
+	TIM1->SR2 = 0;
+
+	for (i = 0; i < 4; i++, ccr += 2)
+	{
+		if (sr & (TIM1_SR1_CC1IF << i))
+		{
+			uint8_t  h   = ccr[0];
+			uint16_t lo  = ((uint16_t)h << 8) | ccr[1]; // reading CCRxL clears CCxIF
+			uint16_t now = cap_counter();
+			uint16_t hi  = cap.hi;
+			if ((TIM1->SR1 & TIM1_SR1_UIF) && now < 0x8000)
+				hi++; // overflow not yet handled
+			if (lo > now)
+				hi--; // captured before the last overflow
+			cap_edge(i, ((uint32_t)hi << 16) | lo);
+		}
+	}
+}
+
+/* -------------------------------------------------------------------------- */
+
+// get the oldest queued time stamp; returns 0 if the queue is empty
+static inline uint8_t cap_get( cap_evt_t *evt )
+{
+	uint8_t tail = cap.tail;
+
+	if (tail == cap.head) return 0;
+	*evt = cap.evt[tail & (CAP_QUEUE - 1)]; // the slot is not reused before tail moves
+	cap.tail = tail + 1;
+	return 1;
+}
+
+// wait for a queued time stamp
+static inline void cap_wait( cap_evt_t *evt )
+{
+	while (!cap_get(evt)) sem_wait(cap.sem);
+}
+
+// period between the last two edges of channel (i), in timer counts, 0 if unknown
+static inline uint32_t cap_period( uint8_t i )
+{
+	uint32_t p;
+	irq_t cc = irq_lock();
+	p = cap.ch[i].period;
+	irq_unlock(cc);
+	return p;
+}
+
+// average frequency of channel (i) in Hz since the previous call, measured
+// between the first and the last edge of the window, 0 if less than two edges
+static inline uint32_t cap_frequency( uint8_t i )
+{
+	cap_ch_t *c = &cap.ch[i];
+	uint32_t span, avg;
+	uint16_t n;
+	irq_t cc = irq_lock();
+	span = c->last - c->first;
+	n    = c->edges;
+	if (n > 1) { c->first = c->last; c->edges = 1; }
+	irq_unlock(cc);
+
+	if (n < 2 || span == 0) return 0;
+	n--;
+	if (span < 0x10000000) // average period in 1/16 counts for resolution
+	{
+		avg = (span << 4) / n;
+		return avg ? (uint32_t)((CAP_CLOCK) * 16UL) / avg : 0;
+	}
+	avg = span / n;
+	return (uint32_t)(CAP_CLOCK) / avg;
+}
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__CAP_H__
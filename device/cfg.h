@@ -0,0 +1,153 @@
+#ifndef __CFG_H__
+#define __CFG_H__
+
+#include <eep.h>
+#include <crc.h>
+#include <rec.h>
+
+// typed persistent configuration read in place from the data EEPROM
+// a configuration is kept in two copies (slots) in the .eeprom segment, each
+// with a header (sequence, layout version, size, CRC-16 of the data); at boot
+// the valid copy with the newer sequence is selected and then read directly
+// through the memory map, nothing is copied to RAM; if neither copy is valid
+// (first boot, other layout version) the constant defaults in ROM are used
+// an update is written asynchronously to the other slot (the data of the active
+// copy with the changed field spliced in) and the header is written last, so
+// the active copy stays intact until the new one is complete
+// rec.h keeps its log at the top of the EEPROM, below REC_BASE is free for slots:
+// CFG_DEF fails to compile if the slots at (addr) reach REC_BASE; that check
+// only sees the constant (addr), which is where the slots go with SDCC; with
+// Cosmic the linker places them and (addr) proves nothing, so there the bound
+// is the .eeprom segment of script.lkf, which ends at __EEP_rec below the log
+// (the link fails if it overflows; keep __EEP_rec equal to REC_PAGES * REC_PAGE)
+//
+// usage:
+//   typedef struct { uint16_t gain; uint8_t mode; } par_t;
+//   CFG_DEF(par, par_t, 1, 0x0000, { 100, 2 });
+//   ...
+//   cfg_init(par);
+//   x = CFG_DATA(par, par_t)->gain;
+//   cfg_update(par, offsetof(par_t, gain), &gain, sizeof(gain)); // async
+
+#if   defined(__CSMC__)
+#define CFG_EEPROM( addr )   @eeprom                  // placed by the linker
+#elif defined(__SDCC)
+#define CFG_EEPROM( addr )   __at(EEP_START + (addr)) // placed at offset (addr)
+#endif
+
+#define CFG_ASSERT( name, expr ) typedef char name[(expr) ? 1 : -1]
+
+/* -------------------------------------------------------------------------- */
+
+typedef struct __cfg_hdr
+{
+	uint8_t  seq;
+	uint8_t  ver;
+	uint16_t size;
+	uint16_t crc;
+}	cfg_hdr_t;
+
+typedef struct __cfg
+{
+	const uint8_t *slot[2]; // copies in the data EEPROM (header followed by data)
+	const void    *def;     // defaults in ROM
+	uint16_t       size;
+	uint8_t        ver;
+	uint8_t        cur;     // active copy: 0, 1, or 2 for the defaults
+	uint8_t        pend;    // copy being written + 1, 0 if none
+	cfg_hdr_t      hdr;     // header being written
+	eep_req_t      req[4];
+}	cfg_t, *cfg_id;
+
+/* -------------------------------------------------------------------------- */
+
+#define _CFG_INIT( eep, def, ver ) \
+        { { (const uint8_t *)&(eep)[0], (const uint8_t *)&(eep)[1] }, &(def), sizeof(def), ver, 2, 0, { 0, 0, 0, 0 }, { { 0 } } }
+
+// define configuration (cfg) of (type) with layout version (ver) and defaults (...)
+// (addr) is the offset of the slots in the data EEPROM, used where the compiler
+// cannot place variables in the .eeprom segment by itself (with Cosmic, the
+// offset the linker gives them)
+#define             CFG_DEF( cfg, type, ver, addr, ... )                                          \
+                    typedef struct { cfg_hdr_t hdr; type data; } cfg##__slot_t;                   \
+                    CFG_ASSERT( cfg##__chk, (addr) + 2 * sizeof(cfg##__slot_t) <= REC_BASE );     \
+                    CFG_EEPROM(addr) volatile cfg##__slot_t cfg##__eep[2];                        \
+                    static const type cfg##__def = __VA_ARGS__;                                   \
+                    cfg_t cfg##__cfg = _CFG_INIT( cfg##__eep, cfg##__def, ver );                  \
+                    cfg_id cfg = & cfg##__cfg
+
+#define CFG_DATA( cfg, type ) ((const type *)cfg_data(cfg))
+
+/* -------------------------------------------------------------------------- */
+
+static inline uint8_t cfg_valid( cfg_id cfg, uint8_t i )
+{
+	const cfg_hdr_t *hdr = (const cfg_hdr_t *)cfg->slot[i];
+	return hdr->ver  == cfg->ver  &&
+	       hdr->size == cfg->size &&
+	       hdr->crc  == crc16(CRC16_INIT, cfg->slot[i] + sizeof(cfg_hdr_t), cfg->size);
+}
+
+static inline void cfg_init( cfg_id cfg )
+{
+	uint8_t a = cfg_valid(cfg, 0);
+	uint8_t b = cfg_valid(cfg, 1);
+
+	cfg->pend = 0;
+	if (a && b)
+		cfg->cur = (int8_t)(cfg->slot[1][0] - cfg->slot[0][0]) > 0 ? 1 : 0;
+	else
+		cfg->cur = a ? 0 : b ? 1 : 2;
+}
+
+static inline uint8_t cfg_busy( cfg_id cfg )
+{
+	if (cfg->pend && !eep_busy(&cfg->req[3]))
+	{
+		cfg->cur  = cfg->pend - 1;
+		cfg->pend = 0;
+	}
+	return cfg->pend != 0;
+}
+
+// the active configuration, read in place
+static inline const void *cfg_data( cfg_id cfg )
+{
+	cfg_busy(cfg);
+	return cfg->cur < 2 ? cfg->slot[cfg->cur] + sizeof(cfg_hdr_t) : cfg->def;
+}
+
+// queue writing (len) bytes of (data) at offset (off) of the configuration;
+// (data) must stay valid until cfg_busy returns 0; returns 0 if an update is pending
+static inline uint8_t cfg_update( cfg_id cfg, uint16_t off, const void *data, uint16_t len )
+{
+	const uint8_t *src = (const uint8_t *)cfg_data(cfg);
+	uint8_t dst = cfg->cur == 0 ? 1 : 0;
+	uint16_t addr = (uint16_t)cfg->slot[dst] - EEP_START;
+	uint16_t end = off + len;
+	uint16_t crc;
+
+	if (cfg->pend || end > cfg->size) return 0;
+
+	crc = crc16(CRC16_INIT, src, off);
+	crc = crc16(crc, data, len);
+	crc = crc16(crc, src + end, cfg->size - end);
+
+	cfg->hdr.seq  = (uint8_t)((cfg->cur < 2 ? cfg->slot[cfg->cur][0] : 0) + 1);
+	cfg->hdr.ver  = cfg->ver;
+	cfg->hdr.size = cfg->size;
+	cfg->hdr.crc  = crc;
+	cfg->pend     = dst + 1;
+
+	addr += sizeof(cfg_hdr_t);
+	eep_write(&cfg->req[0], addr,       src,       off);
+	eep_write(&cfg->req[1], addr + off, data,      len);
+	eep_write(&cfg->req[2], addr + end, src + end, cfg->size - end);
+	eep_write(&cfg->req[3], addr - sizeof(cfg_hdr_t), &cfg->hdr, sizeof(cfg_hdr_t));
+
+	return 1;
+}
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__CFG_H__
@@ -0,0 +1,156 @@
+#ifndef __CPU_H__
+#define __CPU_H__
+
+#include <os.h>
+#include <uart.h>
+#include <tick.h>
+#include <tim.h>
+
+// per-task cpu usage accounting
+// every task brackets its work with cpu_begin / cpu_end, the bracketed time is
+// accumulated from a free-running timer (1 us resolution at 16 MHz); the time
+// not claimed by any task in a measurement window is reported as idle
+// idle is only the remainder: it also holds the kernel, the interrupt
+// handlers and any task code left outside the brackets, so it is an upper
+// bound of the real idle time
+// a single bracket must not exceed one timer period (65 ms at 16 MHz)
+// the kernel port is not part of this tree, so accounting is done at the
+// task level rather than in the context switch
+//
+// usage:
+//   CPU(sla_cpu, "sla");
+//   OS_TSK_DEF(sla) { sem_wait(sem); cpu_begin(sla_cpu); ...; cpu_end(sla_cpu); }
+//   ...
+//   cpu_id tab[] = { sla_cpu, mas_cpu };
+//   cpu_dump(tab, 2); // prints and restarts the window
+
+#ifndef CPU_TIM
+#define CPU_TIM          1    // free-running timer (1, 2 or 3; not 1 with cap.h or enc.h)
+#endif
+
+#define TIM_CLAIM CPU_TIM
+#include <tim.h>
+#define CPU_TIMER        TIM_REG(CPU_TIM)
+
+#define CPU_PSC          4
+#define CPU_CLOCK      ((CPU_FREQUENCY) >> CPU_PSC)
+
+/* -------------------------------------------------------------------------- */
+
+typedef struct __cpu
+{
+	const char *name;
+	uint32_t    busy;  // timer counts accumulated in the current window
+	uint16_t    mark;  // timer count at cpu_begin
+	cnt_t       start; // system time of the start of the window
+}	cpu_t, *cpu_id;
+
+/* -------------------------------------------------------------------------- */
+
+#define _CPU_INIT( name ) { name, 0, 0, 0 }
+
+// define a cpu usage counter (cpu) reported as (name)
+#define             CPU( cpu, name )                     \
+                    cpu_t cpu##__cpu = _CPU_INIT( name ); \
+                    cpu_id cpu = & cpu##__cpu
+
+#define      static_CPU( cpu, name )                     \
+             static cpu_t cpu##__cpu = _CPU_INIT( name ); \
+             static cpu_id cpu = & cpu##__cpu
+
+/* -------------------------------------------------------------------------- */
+
+static inline void cpu_init( void )
+{
+#if CPU_TIM == 1
+	TIM1->PSCRH     = 0;
+	TIM1->PSCRL     = (1 << CPU_PSC) - 1; // TIM1 divides by PSCR + 1
+#else
+	CPU_TIMER->PSCR = CPU_PSC;            // TIM2 / TIM3 by 2^PSCR
+#endif
+	CPU_TIMER->ARRH = 0xFF;
+	CPU_TIMER->ARRL = 0xFF;
+	CPU_TIMER->EGR  = TIM2_EGR_UG;
+	CPU_TIMER->CR1 |= TIM2_CR1_CEN;
+}
+
+static inline uint16_t cpu_counter( void )
+{
+	uint8_t h = CPU_TIMER->CNTRH; // reading CNTRH latches CNTRL
+	return ((uint16_t)h << 8) | CPU_TIMER->CNTRL;
+}
+
+static inline void cpu_begin( cpu_id cpu )
+{
+	cpu->mark = cpu_counter();
+}
+
+static inline void cpu_end( cpu_id cpu )
+{
+	cpu->busy += (uint16_t)(cpu_counter() - cpu->mark);
+}
+
+static inline void cpu_reset( cpu_id cpu )
+{
+	cpu->busy  = 0;
+	cpu->start = sys_time();
+}
+
+// length of the current window of (cpu) in timer counts
+static inline uint32_t cpu_window( cpu_id cpu )
+{
+	return (uint32_t)tick_since(cpu->start) * ((CPU_CLOCK) / (OS_FREQUENCY));
+}
+
+// cpu usage of (cpu) in the current window, in permille
+static inline uint16_t cpu_stats( cpu_id cpu )
+{
+	uint32_t total = cpu_window(cpu);
+	uint32_t busy  = cpu->busy;
+	if (total == 0) return 0;
+	if (busy > total) busy = total;
+	while (total > 0x003FFFFFUL) { total >>= 1; busy >>= 1; } // keep busy * 1000 in range
+	return (uint16_t)((busy * 1000 + total / 2) / total);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static inline void cpu_putPermille( uint16_t val )
+{
+	char buf[8];
+	char *p = buf + sizeof(buf);
+	*--p = 0;
+	*--p = '%';
+	*--p = (char)('0' + val % 10); val /= 10;
+	*--p = '.';
+	do { *--p = (char)('0' + val % 10); val /= 10; } while (val);
+	uart_puts(p);
+}
+
+// print "name: xx.x%" for every counter of (tab) and the remainder, labelled
+// "idle (rest)" as it is not measured, then start a new window for all of them
+static inline void cpu_dump( cpu_id const *tab, uint8_t cnt )
+{
+	uint16_t used = 0;
+	uint16_t val;
+	uint8_t i;
+
+	for (i = 0; i < cnt; i++)
+	{
+		val = cpu_stats(tab[i]);
+		used += val;
+		uart_puts(tab[i]->name);
+		uart_puts(": ");
+		cpu_putPermille(val);
+		uart_puts("\r\n");
+		cpu_reset(tab[i]);
+	}
+
+	uart_puts("idle (rest): ");
+	cpu_putPermille(used < 1000 ? 1000 - used : 0);
+	uart_puts("\r\n");
+}
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__CPU_H__
@@ -0,0 +1,242 @@
+#ifndef __CRC_H__
+#define __CRC_H__
+
+#include <stdint.h>
+#include <osconfig.h>
+
+// CRC kernels, each in three variants selected at compile time:
+//   CRC_BITWISE: bit by bit, no table (smallest, slowest)
+//   CRC_NIBBLE:  4 bits at a time, 16-entry table
+//   CRC_TABLE:   a byte at a time, 256-entry table (fastest)
+// the tables are constant (.const, program memory); define CRC_METHOD, or
+// CRC8_METHOD / CRC16_METHOD / CRC32_METHOD for a single kernel, to choose;
+// by default CRC-8 and CRC-16 use the 256-entry tables, CRC-32 the nibble one
+// the tables are defined once, in crc.c, so the choice belongs in osconfig.h
+// (or the DEFS of the makefile), where crc.c sees it too
+//
+// CRC-8/SMBUS:        poly 0x07, init 0x00, check 0xF4
+// CRC-16/CCITT-FALSE: poly 0x1021, init 0xFFFF, check 0x29B1
+// CRC-32 (IEEE 802.3): poly 0x04C11DB7 reflected, init and final xor
+//                      0xFFFFFFFF (CRC32_FINAL), check 0xCBF43926
+// (check: the CRC of the ASCII string "123456789")
+// the functions are incremental: crc = crcN(crc, buf, len) over any splits
+// CRC_ASM 1 replaces the C loops of the CRC-8 and CRC-16 table kernels with
+// hand-tuned STM8 loops in crc.c (SDCC, medium memory model): the state stays
+// in A or on the stack, the buffer is walked with Y up to an end pointer
+//
+//   kernel  method   table (bytes)  per byte
+//   CRC-8   bitwise      0          8 shift and xor steps
+//           nibble      16          2 lookups
+//           table      256          1 lookup; CRC_ASM: 8 instructions
+//   CRC-16  bitwise      0          8 shift and xor steps
+//           nibble      32          2 lookups
+//           table      512          1 lookup; CRC_ASM: 14 instructions
+//   CRC-32  bitwise      0          8 shift and xor steps
+//           nibble      64          2 lookups
+//           table     1024          1 lookup
+// cycles per byte: test/bench/crc.c, make -C test bench with BENCH_DEFS
+// selecting the methods
+
+#define CRC_BITWISE      0
+#define CRC_NIBBLE       1
+#define CRC_TABLE        2
+
+#ifndef CRC8_METHOD
+#ifdef  CRC_METHOD
+#define CRC8_METHOD      CRC_METHOD
+#else
+#define CRC8_METHOD      CRC_TABLE
+#endif
+#endif
+#ifndef CRC16_METHOD
+#ifdef  CRC_METHOD
+#define CRC16_METHOD     CRC_METHOD
+#else
+#define CRC16_METHOD     CRC_TABLE
+#endif
+#endif
+#ifndef CRC32_METHOD
+#ifdef  CRC_METHOD
+#define CRC32_METHOD     CRC_METHOD
+#else
+#define CRC32_METHOD     CRC_NIBBLE // the 1 KB table only on request
+#endif
+#endif
+
+#ifndef CRC_ASM
+#define CRC_ASM          0
+#endif
+
+#if CRC_ASM && (!defined(__SDCC) || defined(__SDCC_MODEL_LARGE))
+#error CRC_ASM needs SDCC and the medium memory model!
+#endif
+
+// the hand-tuned loops take their arguments on the stack
+#if defined(__SDCCCALL) && __SDCCCALL
+#define CRC_CALL         __sdcccall(0)
+#else
+#define CRC_CALL
+#endif
+
+#define CRC8_INIT        0x00
+#define CRC16_INIT       0xFFFF
+#define CRC32_INIT       0xFFFFFFFFUL
+#define CRC32_FINAL( crc ) ((crc) ^ 0xFFFFFFFFUL)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* -------------------------------------------------------------------------- */
+// CRC-8
+
+#if   CRC8_METHOD == CRC_TABLE
+
+extern const uint8_t crc8_tab[256];
+
+static inline uint8_t crc8_byte( uint8_t crc, uint8_t c )
+{
+	return crc8_tab[crc ^ c];
+}
+
+#elif CRC8_METHOD == CRC_NIBBLE
+
+extern const uint8_t crc8_tab[16];
+
+static inline uint8_t crc8_byte( uint8_t crc, uint8_t c )
+{
+	crc ^= c;
+	crc = (uint8_t)(crc << 4) ^ crc8_tab[crc >> 4];
+	crc = (uint8_t)(crc << 4) ^ crc8_tab[crc >> 4];
+	return crc;
+}
+
+#else
+
+static inline uint8_t crc8_byte( uint8_t crc, uint8_t c )
+{
+	uint8_t i;
+	crc ^= c;
+	for (i = 8; i; i--)
+		crc = (crc & 0x80) ? (uint8_t)(crc << 1) ^ 0x07 : (uint8_t)(crc << 1);
+	return crc;
+}
+
+#endif
+
+#if CRC_ASM && CRC8_METHOD == CRC_TABLE
+
+uint8_t crc8( uint8_t crc, const void *buf, uint16_t len ) CRC_CALL;
+
+#else
+
+static inline uint8_t crc8( uint8_t crc, const void *buf, uint16_t len )
+{
+	const uint8_t *p = (const uint8_t *)buf;
+	while (len--) crc = crc8_byte(crc, *p++);
+	return crc;
+}
+
+#endif
+
+/* -------------------------------------------------------------------------- */
+// CRC-16
+
+#if   CRC16_METHOD == CRC_TABLE
+
+extern const uint16_t crc16_tab[256];
+
+static inline uint16_t crc16_byte( uint16_t crc, uint8_t c )
+{
+	return (uint16_t)(crc << 8) ^ crc16_tab[(uint8_t)(crc >> 8) ^ c];
+}
+
+#elif CRC16_METHOD == CRC_NIBBLE
+
+extern const uint16_t crc16_tab[16];
+
+static inline uint16_t crc16_byte( uint16_t crc, uint8_t c )
+{
+	crc = (uint16_t)(crc << 4) ^ crc16_tab[(uint8_t)(crc >> 12) ^ (c >> 4)];
+	crc = (uint16_t)(crc << 4) ^ crc16_tab[(uint8_t)(crc >> 12) ^ (c & 0x0F)];
+	return crc;
+}
+
+#else
+
+static inline uint16_t crc16_byte( uint16_t crc, uint8_t c )
+{
+	uint8_t i;
+	crc ^= (uint16_t)c << 8;
+	for (i = 8; i; i--)
+		crc = (crc & 0x8000) ? (uint16_t)(crc << 1) ^ 0x1021 : (uint16_t)(crc << 1);
+	return crc;
+}
+
+#endif
+
+#if CRC_ASM && CRC16_METHOD == CRC_TABLE
+
+uint16_t crc16( uint16_t crc, const void *buf, uint16_t len ) CRC_CALL;
+
+#else
+
+static inline uint16_t crc16( uint16_t crc, const void *buf, uint16_t len )
+{
+	const uint8_t *p = (const uint8_t *)buf;
+	while (len--) crc = crc16_byte(crc, *p++);
+	return crc;
+}
+
+#endif
+
+/* -------------------------------------------------------------------------- */
+// CRC-32
+
+#if   CRC32_METHOD == CRC_TABLE
+
+extern const uint32_t crc32_tab[256];
+
+static inline uint32_t crc32_byte( uint32_t crc, uint8_t c )
+{
+	return (crc >> 8) ^ crc32_tab[(uint8_t)crc ^ c];
+}
+
+#elif CRC32_METHOD == CRC_NIBBLE
+
+extern const uint32_t crc32_tab[16];
+
+static inline uint32_t crc32_byte( uint32_t crc, uint8_t c )
+{
+	crc = (crc >> 4) ^ crc32_tab[((uint8_t)crc ^ c) & 0x0F];
+	crc = (crc >> 4) ^ crc32_tab[((uint8_t)crc ^ (c >> 4)) & 0x0F];
+	return crc;
+}
+
+#else
+
+static inline uint32_t crc32_byte( uint32_t crc, uint8_t c )
+{
+	uint8_t i;
+	crc ^= c;
+	for (i = 8; i; i--)
+		crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320UL : (crc >> 1);
+	return crc;
+}
+
+#endif
+
+static inline uint32_t crc32( uint32_t crc, const void *buf, uint16_t len )
+{
+	const uint8_t *p = (const uint8_t *)buf;
+	while (len--) crc = crc32_byte(crc, *p++);
+	return crc;
+}
+
+/* -------------------------------------------------------------------------- */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif//__CRC_H__
@@ -0,0 +1,120 @@
+#ifndef __DDS_H__
+#define __DDS_H__
+
+#include <stm8s.h>
+#include <osconfig.h>
+#include <irq.h>
+#include <tick.h>
+#include <tim.h>
+
+// direct digital synthesis on a PWM channel (DDS_TIM channel 1, TIM3: PD2, TIM2: PD4)
+// the timer runs 8-bit PWM periods (ARR 255) and every update interrupt adds
+// the frequency increment to a 16-bit phase accumulator and loads the sample
+// of a 256-entry table (wave.h or the application's) indexed by the phase
+// high byte into the preloaded compare register, to take effect at the next
+// period; filter the pin with an RC low-pass for the analog waveform
+// the handler is a fixed sequence (flag clear, 16-bit add, table load, one
+// register store) without branches or loops, so its time is bounded and
+// constant; at the default sample rate of 15625 Hz it takes a small share of
+// the CPU and leaves room for the UART and the kernel tick
+// cycles of the handler: test/bench/dds.c (make -C test bench)
+// the increment (frequency) and the table are changed atomically from tasks;
+// the phase stays continuous, so the change is glitch-free
+//
+// usage:
+//   DDS();
+//   INTERRUPT_HANDLER(TIM3_UPD_OVF_BRK_IRQHandler, 15) { dds_handler(); }
+//   ...
+//   dds_start(wave_sine, dds_increment(440));
+
+#ifndef DDS_TIM
+#define DDS_TIM          3    // PWM timer (2 or 3)
+#endif
+
+#define TIM_CLAIM DDS_TIM
+#include <tim.h>
+#define DDS_TIMER        TIM_REG(DDS_TIM)
+#ifndef DDS_PSC
+#define DDS_PSC          2    // PWM clock CPU_FREQUENCY / 4
+#endif
+
+#define DDS_RATE       ((CPU_FREQUENCY) / (1UL << (DDS_PSC)) / 256) // sample rate (Hz)
+
+/* -------------------------------------------------------------------------- */
+
+typedef struct __dds
+{
+	const uint8_t    *wave;
+	volatile uint16_t inc;
+	uint16_t          phase;
+}	dds_t;
+
+extern dds_t dds;
+
+// define the state of the engine
+#define DDS()   dds_t dds
+
+/* -------------------------------------------------------------------------- */
+
+// phase increment for frequency (hz), resolution DDS_RATE / 65536 (0.24 Hz)
+#define DDS_INCREMENT( hz )  ((uint16_t)TICK_CONV(hz, 65536UL, DDS_RATE))
+
+static inline uint16_t dds_increment( uint16_t hz )
+{
+	return TICK_SCALE(hz, 65536UL, DDS_RATE);
+}
+
+// call from the update interrupt handler of DDS_TIM
+static inline void dds_handler( void )
+{
+	DDS_TIMER->SR1 = (uint8_t)~TIM2_SR1_UIF;
+	dds.phase += dds.inc;
+	DDS_TIMER->CCR1L = dds.wave[(uint8_t)(dds.phase >> 8)];
+}
+
+static inline void dds_setIncrement( uint16_t inc )
+{
+	irq_t cc = irq_lock();
+	dds.inc = inc;
+	irq_unlock(cc);
+}
+
+static inline void dds_setWave( const uint8_t *wave )
+{
+	irq_t cc = irq_lock();
+	dds.wave = wave;
+	irq_unlock(cc);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static inline void dds_start( const uint8_t *wave, uint16_t inc )
+{
+	dds.wave  = wave;
+	dds.inc   = inc;
+	dds.phase = 0;
+
+	DDS_TIMER->PSCR  = DDS_PSC;
+	DDS_TIMER->ARRH  = 0;
+	DDS_TIMER->ARRL  = 255;
+	DDS_TIMER->CCMR1 = 0x60 | TIM2_CCMR_OCxPE; // PWM mode 1, preloaded
+	DDS_TIMER->CCR1H = 0;
+	DDS_TIMER->CCR1L = wave[0];
+	DDS_TIMER->CCER1 = TIM2_CCER1_CC1E;
+	DDS_TIMER->CR1  |= TIM2_CR1_ARPE;
+	DDS_TIMER->EGR   = TIM2_EGR_UG;
+	DDS_TIMER->SR1   = (uint8_t)~TIM2_SR1_UIF;
+	DDS_TIMER->IER  |= TIM2_IER_UIE;
+	DDS_TIMER->CR1  |= TIM2_CR1_CEN;
+}
+
+static inline void dds_stop( void )
+{
+	DDS_TIMER->CR1  &= (uint8_t)~TIM2_CR1_CEN;
+	DDS_TIMER->IER  &= (uint8_t)~TIM2_IER_UIE;
+	DDS_TIMER->CCER1 = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__DDS_H__
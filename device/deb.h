@@ -0,0 +1,131 @@
+#ifndef __DEB_H__
+#define __DEB_H__
+
+#include <os.h>
+#include <irq.h>
+
+// bit-parallel debounce of whole GPIO ports
+// every call of deb_tick samples the IDR of each port in the table once and
+// runs eight 2-bit vertical counters in parallel (one bit of each counter per
+// pin in two bytes): a pin changes its debounced state after it has differed
+// from it in 4 consecutive samples, any bounce restarts its counter
+// edges are accumulated as bitmasks (rise, fall) until a task collects them,
+// and the semaphore of the engine is given whenever new edges are published
+// the cost is a dozen byte operations per port per tick, independent of the
+// number of pins; call deb_tick from the tick hook, a TTS entry (tts.h) or a
+// periodic task (prd.h)
+//
+// usage:
+//   OS_SEM(key, 0, semBinary);
+//   deb_port_t keys[] = { DEB_PORT(GPIOB, 0xFF), DEB_PORT(GPIOE, 0x21) };
+//   DEB(deb, keys, key);
+//   ...
+//   deb_init(deb);
+//   OS_TSK_DEF(ui) { deb_wait(deb); if (deb_get(deb, 0, &rise, &fall)) ... }
+
+/* -------------------------------------------------------------------------- */
+
+typedef struct __deb_port
+{
+	GPIO_TypeDef     *gpio;
+	uint8_t           mask;   // debounced pins
+	uint8_t           state;  // debounced level
+	uint8_t           cnt0;   // vertical counter, bit 0
+	uint8_t           cnt1;   // vertical counter, bit 1
+	volatile uint8_t  rise;   // rising edges not yet collected
+	volatile uint8_t  fall;   // falling edges not yet collected
+}	deb_port_t;
+
+typedef struct __deb
+{
+	deb_port_t *tab;
+	uint8_t     cnt;
+	sem_id      sem;  // given when edges are published, may be 0
+}	deb_t, *deb_id;
+
+/* -------------------------------------------------------------------------- */
+
+#define DEB_PORT( gpio, mask ) { gpio, mask, 0, 0, 0, 0, 0 }
+
+#define _DEB_INIT( tab, sem ) { tab, sizeof(tab) / sizeof(*(tab)), sem }
+
+// define debounce engine (deb) for the ports of array (table), signalling (sem)
+#define             DEB( deb, table, sem )                    \
+                    deb_t deb##__deb = _DEB_INIT( table, sem ); \
+                    deb_id deb = & deb##__deb
+
+#define      static_DEB( deb, table, sem )                    \
+             static deb_t deb##__deb = _DEB_INIT( table, sem ); \
+             static deb_id deb = & deb##__deb
+
+/* -------------------------------------------------------------------------- */
+
+// configure the pins as inputs with pull-up and take their levels as the debounced state
+static inline void deb_init( deb_id deb )
+{
+	deb_port_t *p = deb->tab;
+	uint8_t i;
+
+	for (i = 0; i < deb->cnt; i++, p++)
+	{
+		p->gpio->DDR &= (uint8_t)~p->mask;
+		p->gpio->CR1 |= p->mask;
+		p->state = p->gpio->IDR & p->mask;
+		p->cnt0  = 0;
+		p->cnt1  = 0;
+		p->rise  = 0;
+		p->fall  = 0;
+	}
+}
+
+static inline void deb_tick( deb_id deb )
+{
+	deb_port_t *p = deb->tab;
+	uint8_t ev = 0;
+	uint8_t i, delta, chg;
+
+	for (i = 0; i < deb->cnt; i++, p++)
+	{
+		delta    = (p->gpio->IDR ^ p->state) & p->mask;
+		p->cnt1  = (p->cnt1 ^ p->cnt0) & delta; // counters count while the pin differs,
+		p->cnt0  = (uint8_t)~p->cnt0 & delta;   // and are cleared when it does not
+		chg      = delta & (uint8_t)~(p->cnt0 | p->cnt1);
+		if (chg == 0) continue;
+
+		p->state ^= chg;
+		p->rise  |= chg & p->state;
+		p->fall  |= chg & (uint8_t)~p->state;
+		ev = 1;
+	}
+
+	if (ev && deb->sem) sem_give(deb->sem);
+}
+
+/* -------------------------------------------------------------------------- */
+
+// collect and clear the edges of port (i); returns the mask of pins that changed
+static inline uint8_t deb_get( deb_id deb, uint8_t i, uint8_t *rise, uint8_t *fall )
+{
+	deb_port_t *p = &deb->tab[i];
+	irq_t cc = irq_lock();
+	*rise = p->rise; p->rise = 0;
+	*fall = p->fall; p->fall = 0;
+	irq_unlock(cc);
+	return *rise | *fall;
+}
+
+// debounced level of the pins of port (i)
+static inline uint8_t deb_state( deb_id deb, uint8_t i )
+{
+	return deb->tab[i].state;
+}
+
+// wait for new edges
+static inline void deb_wait( deb_id deb )
+{
+	sem_wait(deb->sem);
+}
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__DEB_H__
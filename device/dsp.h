@@ -0,0 +1,198 @@
+#ifndef __DSP_H__
+#define __DSP_H__
+
+#include <stdint.h>
+
+// fixed-point signal processing kernels (Q15 / Q7), no floating point runtime
+// Q15: int16_t, 1 sign bit and 15 fractional bits, range [-1, 1)
+// Q7:  int8_t,  1 sign bit and  7 fractional bits, range [-1, 1)
+// the kernels avoid division and keep multiplications to the minimum the
+// filter needs: the moving average and the first order filter use only adds
+// and shifts, Q7 products map to the 8x8 bit MUL instruction of the STM8
+
+typedef int16_t q15_t;
+typedef int8_t  q7_t;
+
+#define Q15( x ) ((q15_t)((x) >= 1 ? 0x7FFF : (x) * 32768.0 + ((x) < 0 ? -0.5 : 0.5)))
+#define Q14( x ) ((int16_t)((x) * 16384.0 + ((x) < 0 ? -0.5 : 0.5)))
+#define Q7( x )  ((q7_t)((x) >= 1 ? 0x7F : (x) * 128.0 + ((x) < 0 ? -0.5 : 0.5)))
+
+/* -------------------------------------------------------------------------- */
+// saturating arithmetic
+
+static inline q15_t q15_sat( int32_t x )
+{
+	return x > 0x7FFF ? 0x7FFF : x < -0x8000 ? -0x8000 : (q15_t)x;
+}
+
+static inline q7_t q7_sat( int16_t x )
+{
+	return x > 0x7F ? 0x7F : x < -0x80 ? -0x80 : (q7_t)x;
+}
+
+static inline q15_t q15_add( q15_t a, q15_t b ) { return q15_sat((int32_t)a + b); }
+static inline q15_t q15_sub( q15_t a, q15_t b ) { return q15_sat((int32_t)a - b); }
+static inline q7_t  q7_add ( q7_t  a, q7_t  b ) { return q7_sat((int16_t)a + b); }
+static inline q7_t  q7_sub ( q7_t  a, q7_t  b ) { return q7_sat((int16_t)a - b); }
+
+// rounded product; -1 * -1 saturates to 0x7FFF
+static inline q15_t q15_mul( q15_t a, q15_t b )
+{
+	return q15_sat(((int32_t)a * b + 0x4000) >> 15);
+}
+
+static inline q7_t q7_mul( q7_t a, q7_t b )
+{
+	return q7_sat(((int16_t)a * b + 0x40) >> 7);
+}
+
+/* -------------------------------------------------------------------------- */
+// moving average over a power-of-two window: running sum, one add, one
+// subtract and one shift per sample
+
+typedef struct __mav
+{
+	int32_t  sum;
+	uint8_t  idx;
+	uint8_t  mask;  // size - 1
+	uint8_t  shift; // log2(size)
+	int16_t *buf;
+}	mav_t, *mav_id;
+
+#define MAV_ASSERT( name, expr ) typedef char name[(expr) ? 1 : -1]
+
+#define MAV_LOG2( size ) ((size) >= 128 ? 7 : (size) >= 64 ? 6 : (size) >= 32 ? 5 : (size) >= 16 ? 4 : (size) >= 8 ? 3 : (size) >= 4 ? 2 : (size) >= 2 ? 1 : 0)
+
+#define _MAV_INIT( size, buf ) { 0, 0, (uint8_t)((size) - 1), MAV_LOG2(size), buf }
+
+// define moving average (mav) over (size) samples, a power of two up to 128
+#define             MAV( mav, size )                                                  \
+                    MAV_ASSERT( mav##__chk, (size) <= 128 && ((size) & ((size) - 1)) == 0 ); \
+                    int16_t mav##__buf[size];                                         \
+                    mav_t   mav##__mav = _MAV_INIT( size, mav##__buf );               \
+                    mav_id  mav = & mav##__mav
+
+#define      static_MAV( mav, size )                                                  \
+                    MAV_ASSERT( mav##__chk, (size) <= 128 && ((size) & ((size) - 1)) == 0 ); \
+             static int16_t mav##__buf[size];                                         \
+             static mav_t   mav##__mav = _MAV_INIT( size, mav##__buf );               \
+             static mav_id  mav = & mav##__mav
+
+static inline int16_t mav_put( mav_id f, int16_t x )
+{
+	int16_t *p = &f->buf[f->idx];
+	f->sum += (int32_t)x - *p;
+	*p = x;
+	f->idx = (f->idx + 1) & f->mask;
+	return (int16_t)(f->sum >> f->shift);
+}
+
+/* -------------------------------------------------------------------------- */
+// first order low-pass (exponential smoothing), y += (x - y) / 2^k;
+// the state keeps 16 extra fractional bits, so small steps are not lost
+// the difference x - y is taken on the integer part of the state (17 bits)
+// and scaled by shifting its two's complement image as unsigned, so a
+// full-scale step neither overflows nor shifts a negative value; the fraction is subtracted rounded up, which
+// gives the floor of the exact step: the state never passes x
+
+typedef struct __lpf
+{
+	int32_t acc;
+	uint8_t k;   // time constant is about 2^k samples, 0 < k < 16
+}	lpf_t;
+
+#define _LPF_INIT( k ) { 0, k }
+
+static inline int16_t lpf_put( lpf_t *f, int16_t x )
+{
+	int32_t  d  = (int32_t)x - (int16_t)(f->acc >> 16);
+	uint32_t lo = (uint16_t)f->acc;
+	f->acc += (int32_t)((uint32_t)d << (16 - f->k)) - (int32_t)((lo + ((uint32_t)1 << f->k) - 1) >> f->k);
+	return (int16_t)((f->acc + 0x8000) >> 16);
+}
+
+/* -------------------------------------------------------------------------- */
+// biquad, direct form I, coefficients in Q14, each in [-2, 2)
+// y = b0 x + b1 x1 + b2 x2 - a1 y1 - a2 y2
+// the five products are summed in 32 bits: with full-scale signals the sum
+// |b0| + |b1| + |b2| + |a1| + |a2| must stay below 4, or the accumulator
+// overflows; a stable low-pass with unity gain stays below (its b sum to
+// 1 + a1 + a2), a high-pass does not (about 4 + |a1| + |a2| for b near
+// 1, -2, 1), so scale its input down by that sum / 4
+
+typedef struct __biquad
+{
+	int16_t b0, b1, b2, a1, a2; // Q14
+	int16_t x1, x2, y1, y2;
+}	biquad_t;
+
+#define _BIQUAD_INIT( b0, b1, b2, a1, a2 ) { b0, b1, b2, a1, a2, 0, 0, 0, 0 }
+
+static inline int16_t biquad_put( biquad_t *f, int16_t x )
+{
+	int32_t acc = 0x2000; // rounding
+	int16_t y;
+
+	acc += (int32_t)f->b0 * x;
+	acc += (int32_t)f->b1 * f->x1;
+	acc += (int32_t)f->b2 * f->x2;
+	acc -= (int32_t)f->a1 * f->y1;
+	acc -= (int32_t)f->a2 * f->y2;
+	y = q15_sat(acc >> 14);
+
+	f->x2 = f->x1; f->x1 = x;
+	f->y2 = f->y1; f->y1 = y;
+	return y;
+}
+
+/* -------------------------------------------------------------------------- */
+// running median of the last N samples (N odd, up to 15); the window is kept
+// sorted, so each sample costs one removal and one insertion, O(N)
+
+typedef struct __med
+{
+	uint8_t  n;
+	uint8_t  idx;
+	int16_t *hist; // samples in arrival order
+	int16_t *sort; // the same samples, sorted
+}	med_t, *med_id;
+
+#define _MED_INIT( n, hist, sort ) { n, 0, hist, sort }
+
+// define running median (med) of (n) samples
+#define             MED( med, n )                                                     \
+                    MAV_ASSERT( med##__chk, ((n) & 1) && (n) <= 15 );                 \
+                    int16_t med##__hist[n];                                           \
+                    int16_t med##__sort[n];                                           \
+                    med_t   med##__med = _MED_INIT( n, med##__hist, med##__sort );    \
+                    med_id  med = & med##__med
+
+#define      static_MED( med, n )                                                     \
+                    MAV_ASSERT( med##__chk, ((n) & 1) && (n) <= 15 );                 \
+             static int16_t med##__hist[n];                                           \
+             static int16_t med##__sort[n];                                           \
+             static med_t   med##__med = _MED_INIT( n, med##__hist, med##__sort );    \
+             static med_id  med = & med##__med
+
+static inline int16_t med_put( med_id f, int16_t x )
+{
+	int16_t old = f->hist[f->idx];
+	int16_t *s = f->sort;
+	uint8_t i;
+
+	f->hist[f->idx] = x;
+	if (++f->idx == f->n) f->idx = 0;
+
+	for (i = 0; s[i] != old; i++);       // the old sample is always present
+	while (i > 0 && s[i - 1] > x)         // shift the gap down...
+		{ s[i] = s[i - 1]; i--; }
+	while (i < f->n - 1 && s[i + 1] < x)  // ...or up, to where x belongs
+		{ s[i] = s[i + 1]; i++; }
+	s[i] = x;
+
+	return s[f->n >> 1];
+}
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__DSP_H__
@@ -0,0 +1,201 @@
+#ifndef __EEP_H__
+#define __EEP_H__
+
+#include <os.h>
+#include <irq.h>
+
+// asynchronous data EEPROM writer
+// tasks queue write requests and either continue or wait for completion;
+// the end-of-programming interrupt (EEPROM_EEC_IRQHandler, vector 24) advances
+// the queue, using word programming (4 bytes in one cycle) on aligned runs and
+// skipping bytes that already hold the requested value
+// the program memory keeps running (read-while-write) during programming
+// the data of a request must stay valid until the request is completed
+// at most EEP_SKIP bytes are compared per critical section or interrupt, so
+// the time with interrupts masked does not grow with the length of a write;
+// a run of unchanged bytes longer than that stops the queue (no programming,
+// no end-of-programming interrupt) until a task continues it: eep_write,
+// eep_busy and eep_wait do, or call eep_poll from a task
+//
+// usage:
+//   EEP();
+//   INTERRUPT_HANDLER(EEPROM_EEC_IRQHandler, 24) { eep_handler(); }
+//   ...
+//   eep_init();
+//   eep_write(&req, 0x10, &cfg, sizeof(cfg));
+//   eep_wait(&req); // or carry on and check eep_busy(&req) later
+
+#define EEP_START        0x4000 // __EEP_start in script.lkf
+#define EEP_SIZE         0x0400 // __EEP_size  in script.lkf
+
+#ifndef EEP_SKIP
+#define EEP_SKIP         8      // unchanged bytes compared per step, 1..255
+#endif
+
+/* -------------------------------------------------------------------------- */
+
+typedef struct __eep_req
+{
+	struct __eep_req *next;
+	const uint8_t    *data;
+	uint16_t          addr;  // offset in the data EEPROM
+	uint16_t          len;   // bytes left
+	volatile uint8_t  busy;
+}	eep_req_t;
+
+typedef struct __eep
+{
+	eep_req_t * volatile head;
+	eep_req_t *          tail;
+	volatile uint8_t     chunk; // bytes being programmed, 0 when idle or stopped on EEP_SKIP
+}	eep_t;
+
+extern eep_t eep;
+
+// define the state of the writer
+#define EEP()   eep_t eep = { 0, 0, 0 }
+
+/* -------------------------------------------------------------------------- */
+
+static inline void eep_init( void )
+{
+	// a wrong key sequence locks the memory until reset, so write keys only once
+	if ((FLASH->IAPSR & FLASH_IAPSR_DUL) == 0)
+	{
+		FLASH->DUKR = 0xAE;
+		FLASH->DUKR = 0x56;
+	}
+	while ((FLASH->IAPSR & FLASH_IAPSR_DUL) == 0);
+	FLASH->CR1 |= FLASH_CR1_IE;
+}
+
+// start programming the next chunk of the queue, comparing at most EEP_SKIP
+// bytes; called with interrupts masked; returns 1 if it stopped on that bound
+// with nothing started
+static inline uint8_t eep_kick( void )
+{
+	eep_req_t *req;
+	uint8_t skip = EEP_SKIP;
+
+	while ((req = eep.head) != 0)
+	{
+		volatile uint8_t *dst = (volatile uint8_t *)(EEP_START + req->addr);
+
+		while (req->len && *dst == *req->data)
+		{
+			if (skip == 0)
+			{
+				eep.chunk = 0;
+				return 1;
+			}
+			skip--;
+			dst++; req->data++; req->addr++; req->len--;
+		}
+
+		if (req->len >= 4 && (req->addr & 3) == 0)
+		{
+			FLASH->CR2  = FLASH_CR2_WPRG;
+			FLASH->NCR2 = (uint8_t)~FLASH_NCR2_NWPRG;
+			dst[0] = req->data[0];
+			dst[1] = req->data[1];
+			dst[2] = req->data[2];
+			dst[3] = req->data[3];
+			eep.chunk = 4;
+			return 0;
+		}
+
+		if (req->len)
+		{
+			*dst = *req->data;
+			eep.chunk = 1;
+			return 0;
+		}
+
+		eep.head = req->next;
+		if (eep.head == 0) eep.tail = 0;
+		req->busy = 0;
+	}
+
+	eep.chunk = 0;
+	return 0;
+}
+
+// call from EEPROM_EEC_IRQHandler
+static inline void eep_handler( void )
+{
+	uint8_t sr = FLASH->IAPSR; // reading IAPSR clears EOP and WR_PG_DIS
+	eep_req_t *req = eep.head;
+	(void) sr;
+
+	if (req && eep.chunk)
+	{
+		req->data += eep.chunk;
+		req->addr += eep.chunk;
+		req->len  -= eep.chunk;
+	}
+	(void) eep_kick(); // a stop on EEP_SKIP is continued by eep_poll
+}
+
+// continue a queue stopped on EEP_SKIP, one bounded critical section at a time;
+// call from a task
+static inline void eep_poll( void )
+{
+	irq_t cc;
+
+	while (eep.head && eep.chunk == 0)
+	{
+		cc = irq_lock();
+		if (eep.head && eep.chunk == 0) (void) eep_kick();
+		irq_unlock(cc);
+	}
+}
+
+/* -------------------------------------------------------------------------- */
+
+// queue writing (len) bytes of (data) at offset (addr) of the data EEPROM;
+// returns 0 (and leaves the request completed) if the range does not fit in
+// EEP_SIZE, so a bad length cannot reach the option bytes
+static inline uint8_t eep_write( eep_req_t *req, uint16_t addr, const void *data, uint16_t len )
+{
+	irq_t cc;
+
+	if (addr > EEP_SIZE || len > EEP_SIZE - addr)
+	{
+		req->busy = 0;
+		return 0;
+	}
+
+	req->next = 0;
+	req->data = (const uint8_t *)data;
+	req->addr = addr;
+	req->len  = len;
+	req->busy = 1;
+
+	cc = irq_lock();
+	if (eep.tail) eep.tail->next = req; else eep.head = req;
+	eep.tail = req;
+	if (eep.chunk == 0) (void) eep_kick();
+	irq_unlock(cc);
+	eep_poll();
+	return 1;
+}
+
+static inline uint8_t eep_busy( eep_req_t *req )
+{
+	eep_poll();
+	return req->busy;
+}
+
+// yield to other tasks until the request is completed
+static inline void eep_wait( eep_req_t *req )
+{
+	while (req->busy)
+	{
+		eep_poll();
+		tsk_yield();
+	}
+}
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__EEP_H__
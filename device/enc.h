@@ -0,0 +1,192 @@
+#ifndef __ENC_H__
+#define __ENC_H__
+
+#include <os.h>
+#include <irq.h>
+#include <tim.h>
+#include <tick.h>
+
+// quadrature encoder on TIM1 (A: CH1 PC1, B: CH2 PC2) in encoder mode
+// (the only timer of the STM8S105 with a slave mode controller; TIM2 and
+// TIM3 have none, and TIM1 cannot be used by cap.h at the same time)
+// the timer counts all four edges of every cycle in hardware, there are no
+// per-edge interrupts; enc_tick, called at ENC_FREQUENCY (tick hook, TTS
+// entry), extends the count to 32 bits and estimates the velocity
+// velocity combines edge count and edge time (M/T method): a window opens
+// at a tick that saw the counter move (an edge time stamp, at tick
+// resolution) and closes at the first tick that saw it move after it has
+// counted ENC_EDGES counts or lasted ENC_WINDOW ticks; the velocity is the
+// counts divided by the time between these two edges, so fast shafts update
+// every tick and slow ones are timed from edge to edge instead of reading
+// as a few counts per tick (or none); while no edge comes the velocity is
+// bounded by one count in the time waited, and it reads 0 after ENC_STOP ticks
+// the division by the edge time is a multiply by ENC_FREQUENCY / m from a
+// table of reciprocals (integer part and 16-bit fraction, tick.h) built by
+// the compiler; the counter must be sampled before it moves by 32768 counts
+//
+// usage:
+//   ENC();
+//   static void loop( void ) { enc_tick(); ... }   // e.g. a TTS entry
+//   ...
+//   enc_init();
+//   x = enc_position(); v = enc_velocity();
+
+#ifndef ENC_FREQUENCY
+#define ENC_FREQUENCY    OS_FREQUENCY // rate of enc_tick (Hz)
+#endif
+#ifndef ENC_EDGES
+#define ENC_EDGES        16           // counts closing a velocity window
+#endif
+#ifndef ENC_WINDOW
+#define ENC_WINDOW       64           // ticks closing a velocity window, up to 64
+#endif
+#ifndef ENC_STOP
+#define ENC_STOP         250          // ticks without an edge reading as stopped, up to 255
+#endif
+#ifndef ENC_FILTER
+#define ENC_FILTER       3            // input filter (ICxF), 8 samples at fCPU
+#endif
+
+#define TIM_CLAIM 1
+#include <tim.h>
+
+/* -------------------------------------------------------------------------- */
+
+typedef struct __enc_rate
+{
+	uint16_t i;     // ENC_FREQUENCY / m: integer part
+	uint16_t f;     // 16-bit fraction, rounded up
+}	enc_rate_t;
+
+typedef struct __enc
+{
+	int32_t  pos;   // position (counts)
+	int32_t  vel;   // velocity (counts per second)
+	int32_t  acc;   // counts since the edge opening the window
+	uint16_t last;  // last counter value
+	uint8_t  n;     // ticks since the edge opening the window (up to ENC_STOP)
+	uint8_t  m;     // ticks from the edge opening the window to the last edge
+}	enc_t;
+
+extern enc_t enc;
+extern const enc_rate_t enc_rate[64];
+
+#define ENC_ASSERT( name, expr ) typedef char name[(expr) ? 1 : -1]
+
+ENC_ASSERT( enc__chk, (ENC_WINDOW) >= 1 && (ENC_WINDOW) <= 64 && (ENC_STOP) >= (ENC_WINDOW) && (ENC_STOP) <= 255 );
+
+#define _ENC_R( m )     { TICK_INT(ENC_FREQUENCY, m), TICK_FRAC(ENC_FREQUENCY, m) }
+#define _ENC_R4( m )    _ENC_R(m), _ENC_R((m) + 1), _ENC_R((m) + 2), _ENC_R((m) + 3)
+#define _ENC_R16( m )   _ENC_R4(m), _ENC_R4((m) + 4), _ENC_R4((m) + 8), _ENC_R4((m) + 12)
+
+// define the state of the driver and the table of ENC_FREQUENCY / m, m = 1..64
+#define ENC()   enc_t enc; \
+                const enc_rate_t enc_rate[64] = { _ENC_R16(1), _ENC_R16(17), _ENC_R16(33), _ENC_R16(49) }
+
+/* -------------------------------------------------------------------------- */
+
+static inline uint16_t enc_counter( void )
+{
+	uint8_t h = TIM1->CNTRH; // reading CNTRH latches CNTRL
+	return ((uint16_t)h << 8) | TIM1->CNTRL;
+}
+
+static inline void enc_init( void )
+{
+	TIM1->CR1   = 0;
+	TIM1->ARRH  = 0xFF;
+	TIM1->ARRL  = 0xFF;
+	TIM1->CCMR1 = (uint8_t)((ENC_FILTER) << 4) | 1; // IC1 on TI1
+	TIM1->CCMR2 = (uint8_t)((ENC_FILTER) << 4) | 1; // IC2 on TI2
+	TIM1->CCER1 = 0;                                // non-inverted
+	TIM1->SMCR  = 3;                                // encoder mode 3: count on TI1 and TI2
+	TIM1->CR1   = TIM1_CR1_CEN;
+
+	enc.pos  = 0;
+	enc.vel  = 0;
+	enc.acc  = 0;
+	enc.n    = ENC_STOP; // no edge yet
+	enc.m    = 0;
+	enc.last = enc_counter();
+}
+
+// (acc) counts in (m) ticks, in counts per second: |acc| * (i + f / 2^16);
+// above 64 ticks, ENC_FREQUENCY / m is taken as ENC_FREQUENCY / (m / 2^s) / 2^s
+static inline int32_t enc_scale( int32_t acc, uint8_t m )
+{
+	const enc_rate_t *r;
+	uint16_t a = (uint16_t)(acc < 0 ? -acc : acc); // below 32768 + ENC_EDGES
+	uint32_t v;
+	uint8_t  s = 0;
+
+	while (m > 64) { m = (uint8_t)((m + 1) >> 1); s++; }
+	r = &enc_rate[m - 1];
+	v = ((uint32_t)a * r->i + (((uint32_t)a * r->f) >> 16)) >> s;
+	return acc < 0 ? -(int32_t)v : (int32_t)v;
+}
+
+static inline void enc_tick( void )
+{
+	uint16_t cnt = enc_counter();
+	int16_t  d   = (int16_t)(cnt - enc.last);
+	int32_t  max;
+
+	enc.last = cnt;
+	enc.pos += d;
+	if (enc.n < ENC_STOP) enc.n++;
+
+	if (d != 0)
+	{
+		if (enc.n == ENC_STOP && enc.acc == 0)
+		{
+			enc.n = 0; // the first edge after a stop only opens a window
+			return;
+		}
+		enc.acc += d;
+		enc.m    = enc.n;
+		if (enc.acc < ENC_EDGES && enc.acc > -(ENC_EDGES) && enc.n < ENC_WINDOW)
+			return;
+	}
+	else
+	{
+		if (enc.n < ENC_WINDOW)
+			return;
+		if (enc.acc == 0) // no edge yet: slower than one count in (n) ticks
+		{
+			max = enc.n == ENC_STOP ? 0 : enc_scale(1, enc.n);
+			if      (enc.vel >  max) enc.vel =  max;
+			else if (enc.vel < -max) enc.vel = -max;
+			return;
+		}
+	}
+
+	// close the window at its last edge, which opens the next one
+	enc.vel = enc_scale(enc.acc, enc.m);
+	enc.n  -= enc.m;
+	enc.acc = 0;
+	enc.m   = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static inline int32_t enc_position( void )
+{
+	int32_t x;
+	irq_t cc = irq_lock();
+	x = enc.pos;
+	irq_unlock(cc);
+	return x;
+}
+
+static inline int32_t enc_velocity( void )
+{
+	int32_t v;
+	irq_t cc = irq_lock();
+	v = enc.vel;
+	irq_unlock(cc);
+	return v;
+}
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__ENC_H__
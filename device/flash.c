@@ -0,0 +1,153 @@
+#define __FLASH_C__
+#include <string.h>
+#include <flash.h>
+#include <irq.h>
+
+// with SDCC the file is empty until the RAM routine is verified (flash.h)
+#if !defined(__SDCC) || defined(FLASH_SDCC_VERIFIED)
+
+/* -------------------------------------------------------------------------- */
+
+#if   defined(__CSMC__)
+
+int _fctcpy( char name );
+
+#pragma section (ramcode)
+
+// copy (len) bytes to the block and wait for the end of the operation; in RAM
+static uint8_t flash_ram( uint8_t *dst, const uint8_t *src, uint8_t len, uint8_t cr2 )
+{
+	uint8_t sr;
+
+	FLASH->CR2  = cr2;
+	FLASH->NCR2 = (uint8_t)~cr2;
+	do *dst++ = *src++; while (--len);
+	do sr = FLASH->IAPSR & (FLASH_IAPSR_EOP | FLASH_IAPSR_WR_PG_DIS); while (sr == 0);
+
+	return sr;
+}
+
+#pragma section ()
+
+void flash_init( void )
+{
+	_fctcpy('r'); // copy the .ramcode segment to RAM
+}
+
+#elif defined(__SDCC)
+
+static uint16_t flash_dst;
+static uint16_t flash_src;
+static uint8_t  flash_len;
+static uint8_t  flash_cr2;
+static uint8_t  flash_sr;
+
+extern const uint8_t flash_image_end[];
+
+#define FLASH_IMAGE_SIZE 64 // RAM buffer of flash_ram, the image size is checked at assembly time
+#define FLASH_STR_( x )  #x
+#define FLASH_STR( x )   FLASH_STR_( x )
+
+// position-independent image of the RAM routine (relative jumps only),
+// copied to the stack and called from there
+static void flash_image( void ) __naked
+{
+	__asm__(
+	"pushw y\n"
+	"ldw x, _flash_src\n"
+	"ldw y, _flash_dst\n"
+	"ld a, _flash_cr2\n"
+	"ld 0x505b, a\n"       // FLASH->CR2
+	"cpl a\n"
+	"ld 0x505c, a\n"       // FLASH->NCR2
+	"ld a, _flash_len\n"
+	"push a\n"
+	"00001$:\n"
+	"ld a, (x)\n"
+	"ld (y), a\n"
+	"incw x\n"
+	"incw y\n"
+	"dec (1, sp)\n"
+	"jrne 00001$\n"
+	"pop a\n"
+	"00002$:\n"
+	"ld a, 0x505f\n"       // FLASH->IAPSR
+	"and a, #0x05\n"       // EOP | WR_PG_DIS
+	"jreq 00002$\n"
+	"ld _flash_sr, a\n"
+	"popw y\n"
+	"ret\n"
+	"_flash_image_end::\n"
+	".ifgt _flash_image_end - _flash_image - " FLASH_STR(FLASH_IMAGE_SIZE) "\n"
+	".error 1 ; flash_image does not fit the RAM buffer of flash_ram\n"
+	".endif\n");
+}
+
+static uint8_t flash_ram( uint8_t *dst, const uint8_t *src, uint8_t len, uint8_t cr2 )
+{
+	uint8_t ram[FLASH_IMAGE_SIZE];
+
+	flash_dst = (uint16_t)dst;
+	flash_src = (uint16_t)src;
+	flash_len = len;
+	flash_cr2 = cr2;
+	memcpy(ram, (const void *)flash_image, (size_t)(flash_image_end - (const uint8_t *)flash_image));
+	((void (*)(void))ram)();
+
+	return flash_sr;
+}
+
+void flash_init( void )
+{
+}
+
+#else
+#error Unsupported compiler!
+#endif
+
+/* -------------------------------------------------------------------------- */
+
+static uint8_t flash_block( uint16_t addr, const uint8_t *src, uint8_t len, uint8_t cr2 )
+{
+	uint8_t rom = addr >= FLASH_ROM_START;
+	uint8_t sr;
+	irq_t cc;
+
+	if (addr % FLASH_BLOCK) return 0;
+	if (!rom && (addr < FLASH_EEP_START || addr >= FLASH_EEP_END)) return 0;
+
+	// a wrong key sequence locks the memory until reset, so write keys only once
+	if (rom && (FLASH->IAPSR & FLASH_IAPSR_PUL) == 0)
+	{
+		FLASH->PUKR = 0x56;
+		FLASH->PUKR = 0xAE;
+	}
+	if (!rom && (FLASH->IAPSR & FLASH_IAPSR_DUL) == 0)
+	{
+		FLASH->DUKR = 0xAE;
+		FLASH->DUKR = 0x56;
+	}
+
+	cc = irq_lock();
+	sr = flash_ram((uint8_t *)addr, src, len, cr2);
+	irq_unlock(cc);
+
+	if (rom) FLASH->IAPSR &= (uint8_t)~FLASH_IAPSR_PUL;
+
+	return (sr & FLASH_IAPSR_WR_PG_DIS) == 0;
+}
+
+uint8_t flash_erase( uint16_t addr )
+{
+	uint8_t zero[4] = { 0, 0, 0, 0 };
+	return flash_block(addr, zero, sizeof(zero), FLASH_CR2_ERASE);
+}
+
+uint8_t flash_program( uint16_t addr, const uint8_t *src )
+{
+	return flash_block(addr, src, FLASH_BLOCK, flash_erased(addr) ? FLASH_CR2_FPRG : FLASH_CR2_PRG);
+}
+
+/* -------------------------------------------------------------------------- */
+
+#endif
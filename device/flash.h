@@ -0,0 +1,54 @@
+#ifndef __FLASH_H__
+#define __FLASH_H__
+
+#include <stm8s.h>
+
+// block erase / programming of program memory and data EEPROM
+// the block operations stall the program memory, so the write loop runs from
+// RAM (flash.c): with CSMC it is linked into the .ramcode segment (script.lkf)
+// and copied there by flash_init, with SDCC a position-independent routine is
+// copied to the stack for every operation
+// a block is programmed in fast mode (FPRG, no erase cycle, half the time)
+// when it is already erased, in standard mode (PRG) otherwise
+// interrupts are masked for the whole operation (a few ms); do not mix with
+// pending asynchronous EEPROM writes (eep.h)
+// the SDCC routine has not been assembled or run under sstm8 yet, so with
+// SDCC it is compiled out and this header stops the build until someone has
+// verified it and defines FLASH_SDCC_VERIFIED (in the DEFS of the makefile)
+
+#if defined(__SDCC) && !defined(FLASH_SDCC_VERIFIED) && !defined(__FLASH_C__)
+#error flash.h: the SDCC RAM routine of flash.c is not verified under sstm8, see FLASH_SDCC_VERIFIED
+#endif
+
+#define FLASH_BLOCK      128 // block size (STM8S105)
+
+#define FLASH_ROM_START  0x8000
+#define FLASH_ROM_END    0x10000UL
+#define FLASH_EEP_START  0x4000
+#define FLASH_EEP_END    0x4400
+
+/* -------------------------------------------------------------------------- */
+
+void    flash_init   ( void );
+
+// erase the block at (addr); returns 1 on success
+uint8_t flash_erase  ( uint16_t addr );
+
+// program the block at (addr) with FLASH_BLOCK bytes of (src), which must not
+// be in program memory; returns 1 on success
+uint8_t flash_program( uint16_t addr, const uint8_t *src );
+
+/* -------------------------------------------------------------------------- */
+
+static inline uint8_t flash_erased( uint16_t addr )
+{
+	const uint8_t *p = (const uint8_t *)addr;
+	uint8_t i;
+	for (i = 0; i < FLASH_BLOCK; i++)
+		if (p[i]) return 0; // erased flash reads 0x00
+	return 1;
+}
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__FLASH_H__
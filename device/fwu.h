@@ -0,0 +1,253 @@
+#ifndef __FWU_H__
+#define __FWU_H__
+
+#include <string.h>
+#include <os.h>
+#include <uart.h>
+#include <flash.h>
+#include <crc.h>
+#include <rec.h>
+#include <tick.h>
+
+// resumable firmware update over UART2
+// the image is received in blocks of FLASH_BLOCK bytes and written to the
+// region [FWU_START, FWU_START + FWU_SIZE) with block programming (fast mode
+// on erased blocks); activating the image is up to the bootloader
+// the progress is kept in the record store (rec.h) under FWU_KEY, so an
+// interrupted transfer of the same image resumes from the last good block
+//
+// frames from the host:
+//   'Q' id(2)                   query: start or resume the image identified by id
+//   'D' idx(2) data(128) crc(2) block (crc: CRC-16 of idx and data)
+//   'E' cnt(2) crc(2)           end: image of cnt blocks, crc of the whole image
+// replies (all numbers little endian):
+//   'R' next(2) window(1)       resume from block next, in windows of (window) blocks
+//   'A' next(2)                 blocks below next are programmed, send the next window
+//   'N' next(2)                 bad or unexpected block, resend from block next
+//   'K' / 'F'                   image verified / failed
+// the flow control is stop-and-wait on windows of FWU_WINDOW blocks (2 by
+// default), not the sliding window first asked for, which would need the
+// host to keep sending while a window is being programmed: the host sends
+// one window and waits for 'A' or 'N' before
+// sending anything else, because interrupts are masked (the UART receiver is
+// not serviced) while the buffered blocks are being programmed; a last window
+// shorter than FWU_WINDOW is programmed by 'E'
+// after 'N' the host waits FWU_TIMEOUT before resending so the parser resyncs
+// test/fwu.cpp is the host sender, tested against this engine over a pty
+//
+// usage:
+//   FWU();
+//   OS_TSK_DEF(upd) { fwu_poll(); tsk_yield(); }
+//   ...
+//   fwu_init(); // after uart_init, flash_init, rec_init
+
+#ifndef FWU_START
+#define FWU_START        0xC000
+#endif
+#ifndef FWU_SIZE
+#define FWU_SIZE         0x4000
+#endif
+#ifndef FWU_WINDOW
+#define FWU_WINDOW       2      // blocks per stop-and-wait window, buffered in RAM
+#endif
+#ifndef FWU_KEY
+#define FWU_KEY          0xF0   // record key of the progress
+#endif
+#ifndef FWU_TIMEOUT
+#define FWU_TIMEOUT     (SEC/20)
+#endif
+
+#define FWU_BLOCKS     ((uint16_t)((FWU_SIZE) / (FLASH_BLOCK)))
+
+/* -------------------------------------------------------------------------- */
+
+typedef struct __fwu_prog
+{
+	uint16_t id;    // image id
+	uint16_t next;  // first block not yet programmed
+}	fwu_prog_t;
+
+typedef struct __fwu
+{
+	fwu_prog_t prog;
+	uint16_t   recv;   // next block expected from the host
+	uint8_t    cnt;    // blocks buffered
+	uint8_t    type;   // type of the frame being received, 0 when idle
+	uint8_t    pos;    // bytes of the frame received
+	uint8_t    done;   // image verified
+	cnt_t      time;   // time of the last byte received
+	uint8_t    hdr[4];
+	uint8_t    buf[FWU_WINDOW][FLASH_BLOCK];
+}	fwu_t;
+
+extern fwu_t fwu;
+
+// define the state of the update engine
+#define FWU()   fwu_t fwu
+
+/* -------------------------------------------------------------------------- */
+
+static inline void fwu_reply( uint8_t type, uint16_t val )
+{
+	uint8_t msg[3];
+	msg[0] = type;
+	msg[1] = (uint8_t)(val);
+	msg[2] = (uint8_t)(val >> 8);
+	uart_write(msg, sizeof(msg));
+}
+
+static inline void fwu_save( void )
+{
+	rec_put(FWU_KEY, &fwu.prog, sizeof(fwu.prog));
+}
+
+static inline void fwu_init( void )
+{
+	uint8_t len;
+	const void *p = rec_get(FWU_KEY, &len);
+	fwu_prog_t prog;
+
+	fwu.prog.id   = 0;
+	fwu.prog.next = 0;
+	if (p && len == sizeof(fwu_prog_t))
+	{
+		memcpy(&prog, p, sizeof(prog)); // the record has no alignment
+		if (prog.next <= FWU_BLOCKS)
+			fwu.prog = prog;
+	}
+	fwu.recv = fwu.prog.next;
+	fwu.cnt  = 0;
+	fwu.type = 0;
+	fwu.done = 0;
+}
+
+// program the buffered blocks; returns 1 on success
+static inline uint8_t fwu_commit( void )
+{
+	uint8_t i;
+
+	for (i = 0; i < fwu.cnt; i++)
+		if (!flash_program(FWU_START + (fwu.prog.next + i) * FLASH_BLOCK, fwu.buf[i]))
+			break;
+
+	fwu.prog.next += i;
+	fwu.recv = fwu.prog.next;
+	if (i) fwu_save();
+	i = (i == fwu.cnt);
+	fwu.cnt = 0;
+
+	return i;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static inline void fwu_query( void )
+{
+	uint16_t id = fwu.hdr[0] | ((uint16_t)fwu.hdr[1] << 8);
+	uint8_t msg[4];
+
+	if (fwu.prog.id != id)
+	{
+		fwu.prog.id   = id;
+		fwu.prog.next = 0;
+		fwu_save();
+	}
+	fwu.recv = fwu.prog.next;
+	fwu.cnt  = 0;
+	fwu.done = 0;
+
+	msg[0] = 'R';
+	msg[1] = (uint8_t)(fwu.prog.next);
+	msg[2] = (uint8_t)(fwu.prog.next >> 8);
+	msg[3] = FWU_WINDOW;
+	uart_write(msg, sizeof(msg));
+}
+
+static inline void fwu_data( void )
+{
+	uint8_t *blk = fwu.buf[fwu.cnt];
+	uint16_t idx = fwu.hdr[0] | ((uint16_t)fwu.hdr[1] << 8);
+	uint16_t crc = crc16(crc16(CRC16_INIT, fwu.hdr, 2), blk, FLASH_BLOCK);
+	uint8_t ok;
+
+	if (crc != (fwu.hdr[2] | ((uint16_t)fwu.hdr[3] << 8)) || idx != fwu.recv || idx >= FWU_BLOCKS)
+	{
+		fwu_reply('N', fwu.recv);
+		return;
+	}
+
+	fwu.recv++;
+	if (++fwu.cnt < FWU_WINDOW)
+		return;
+
+	ok = fwu_commit(); // before reading prog.next, which it advances
+	fwu_reply(ok ? 'A' : 'N', fwu.prog.next);
+}
+
+static inline void fwu_end( void )
+{
+	uint16_t cnt = fwu.hdr[0] | ((uint16_t)fwu.hdr[1] << 8);
+	uint16_t crc = fwu.hdr[2] | ((uint16_t)fwu.hdr[3] << 8);
+
+	if (fwu_commit() && cnt == fwu.prog.next && cnt <= FWU_BLOCKS &&
+	    crc16(CRC16_INIT, (const uint8_t *)FWU_START, cnt * FLASH_BLOCK) == crc)
+	{
+		fwu.done = 1;
+		fwu.prog.next = 0;
+		fwu.prog.id   = 0;
+		fwu_save();
+		uart_write("K", 1);
+	}
+	else
+	{
+		uart_write("F", 1);
+	}
+	fwu.recv = fwu.prog.next;
+}
+
+/* -------------------------------------------------------------------------- */
+
+// process the bytes received so far; call repeatedly from a task
+static inline void fwu_poll( void )
+{
+	uint8_t c;
+
+	if (fwu.type && tick_timeout(fwu.time, FWU_TIMEOUT))
+		fwu.type = 0; // resync after a broken frame
+
+	while (uart_getc(&c))
+	{
+		fwu.time = sys_time();
+
+		if (fwu.type == 0)
+		{
+			if (c == 'Q' || c == 'D' || c == 'E') { fwu.type = c; fwu.pos = 0; }
+			continue;
+		}
+
+		switch (fwu.type)
+		{
+		case 'Q':
+			fwu.hdr[fwu.pos++] = c;
+			if (fwu.pos == 2) { fwu.type = 0; fwu_query(); }
+			break;
+		case 'E':
+			fwu.hdr[fwu.pos++] = c;
+			if (fwu.pos == 4) { fwu.type = 0; fwu_end(); }
+			break;
+		case 'D':
+			if      (fwu.pos < 2)               fwu.hdr[fwu.pos] = c;
+			else if (fwu.pos < 2 + FLASH_BLOCK) fwu.buf[fwu.cnt][fwu.pos - 2] = c;
+			else                                fwu.hdr[fwu.pos - FLASH_BLOCK] = c;
+			if (++fwu.pos == 4 + FLASH_BLOCK) { fwu.type = 0; fwu_data(); }
+			break;
+		default:
+			fwu.type = 0;
+			break;
+		}
+	}
+}
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__FWU_H__
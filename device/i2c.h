@@ -0,0 +1,347 @@
+#ifndef __I2C_H__
+#define __I2C_H__
+
+#include <os.h>
+#include <irq.h>
+
+// i2c: I2C master (SCL: PB4, SDA: PB5), queued transactions run by the
+// interrupt handler as a state machine, tasks never poll the status registers
+// a transaction writes (wlen) bytes, then, if (rlen) is not 0, generates a
+// repeated start and reads (rlen) bytes; the reads follow the procedures of
+// the reference manual for the STM8 I2C: one byte (NACK and STOP programmed
+// on ADDR), two bytes (POS, NACK on ADDR, STOP on BTF) and N bytes (RXNE
+// until three are left, then NACK and STOP on BTF); between the write and the
+// read the handler waits in I2C_START for SB and ADDR, ignoring the BTF that
+// stays set until the repeated start is generated
+// a transaction with (wlen) and (rlen) both 0 only addresses the slave (probe)
+// transactions are completed in order, so a batch of register reads from
+// several sensors is queued with the semaphore on the last one only and the
+// task waits once; a transaction queued behind another one is started by a
+// repeated start in place of the STOP, so the handler never waits for the
+// bus; only i2c_transfer, in the task, waits for a STOP already requested
+//
+// usage:
+//   I2C_DEF();
+//   INTERRUPT_HANDLER(I2C_IRQHandler, 19) { i2c_handler(); }
+//   OS_SEM(done, 0, semBinary);
+//   ...
+//   i2c_init();
+//   i2c_readReg(&req[0], 0x68, 0x3B, acc, 6, 0);
+//   i2c_readReg(&req[1], 0x1E, 0x03, mag, 6, 0);
+//   i2c_readReg(&req[2], 0x77, 0xF6, prs, 3, done);
+//   i2c_wait(&req[2]);
+//   if (req[0].err || req[1].err || req[2].err) ...
+
+#ifndef I2C_SPEED
+#define I2C_SPEED        100000 // SCL frequency (Hz), up to 400000
+#endif
+
+#define I2C_FREQ       ((CPU_FREQUENCY) / 1000000)
+#if   (I2C_SPEED) <= 100000
+#define I2C_CCR        ((CPU_FREQUENCY) / ((I2C_SPEED) * 2))          // standard mode
+#define I2C_RISE       ((I2C_FREQ) + 1)                                  // 1000 ns
+#else
+#define I2C_CCR       (((CPU_FREQUENCY) / ((I2C_SPEED) * 3)) | 0x8000) // fast mode (FS), duty 2:1
+#define I2C_RISE       ((I2C_FREQ) * 3 / 10 + 1)                         // 300 ns
+#endif
+
+#define I2C_WRITE        1  // address for write, then (wlen) bytes
+#define I2C_START        2  // (repeated) start for read: waiting for SB, then ADDR
+#define I2C_READ         3  // (rlen) bytes
+
+/* -------------------------------------------------------------------------- */
+
+typedef struct __i2c_req
+{
+	struct __i2c_req *next;
+	uint8_t           addr;  // 7-bit slave address
+	uint8_t           reg;   // register address for i2c_readReg
+	const uint8_t    *wbuf;
+	uint8_t          *rbuf;
+	uint8_t           wlen;
+	uint8_t           rlen;
+	uint8_t           pos;
+	uint8_t           phase; // I2C_WRITE, I2C_START, I2C_READ
+	uint8_t           err;   // SR2 error flags, 0 on success
+	sem_id            sem;   // given on completion, may be 0
+	volatile uint8_t  busy;
+}	i2c_req_t;
+
+typedef struct __i2c
+{
+	i2c_req_t * volatile head;
+	i2c_req_t *          tail;
+	volatile uint8_t     stop; // the transaction at the head requested a STOP
+}	i2c_t;
+
+extern i2c_t i2c;
+
+// define the state of the driver
+#define I2C_DEF()   i2c_t i2c = { 0, 0, 0 }
+
+/* -------------------------------------------------------------------------- */
+
+static inline void i2c_init( void )
+{
+	I2C->CR1    = 0;
+	I2C->FREQR  = (uint8_t)(I2C_FREQ);
+	I2C->CCRH   = (uint8_t)((I2C_CCR) >> 8);
+	I2C->CCRL   = (uint8_t)(I2C_CCR);
+	I2C->TRISER = (uint8_t)(I2C_RISE);
+	I2C->OARH   = I2C_OARH_ADDCONF;
+	I2C->CR1    = I2C_CR1_PE;
+}
+
+// prepare the transaction at the head of the queue, its start is requested by the caller
+static inline void i2c_begin( i2c_req_t *req )
+{
+	req->pos   = 0;
+	req->phase = req->wlen || req->rlen == 0 ? I2C_WRITE : I2C_START;
+	I2C->ITR   = I2C_ITR_ITEVTEN | I2C_ITR_ITERREN; // ITBUFEN from ADDR on, as needed
+}
+
+// start the transaction at the head of the idle queue; called from a task with
+// interrupts masked, waits for the STOP of the previous one (half an SCL period)
+static inline void i2c_kick( void )
+{
+	while (I2C->CR2 & I2C_CR2_STOP);
+	i2c.stop = 0;
+	i2c_begin(i2c.head);
+	I2C->CR2 |= I2C_CR2_START;
+}
+
+// end the transaction at the head: a repeated start for the next one if any is
+// queued, else a STOP; POS is cleared in the same write of CR2
+static inline void i2c_end( void )
+{
+	uint8_t cr2 = (uint8_t)(I2C->CR2 & ~I2C_CR2_POS);
+
+	if (i2c.head->next)
+	{
+		I2C->CR2 = (uint8_t)(cr2 | I2C_CR2_START);
+	}
+	else
+	{
+		I2C->CR2 = (uint8_t)(cr2 | I2C_CR2_STOP);
+		i2c.stop = 1;
+	}
+}
+
+// complete the transaction at the head (ended by i2c_end) and prepare the next one
+static inline void i2c_done( uint8_t err )
+{
+	i2c_req_t *req = i2c.head;
+
+	i2c.head = req->next;
+	if (i2c.head == 0)
+	{
+		i2c.tail = 0;
+		I2C->ITR = 0;
+	}
+	else
+	{
+		i2c_begin(i2c.head);
+	}
+	req->err  = err;
+	req->busy = 0;
+	if (req->sem) sem_give(req->sem);
+}
+
+// read the last two bytes (one in DR, one in the shift register) on BTF
+static inline void i2c_readLast( i2c_req_t *req )
+{
+	i2c_end();
+	req->rbuf[req->pos++] = I2C->DR;
+	req->rbuf[req->pos++] = I2C->DR;
+	i2c_done(0);
+}
+
+/* -------------------------------------------------------------------------- */
+
+// call from I2C_IRQHandler
+static inline void i2c_handler( void )
+{
+	i2c_req_t *req = i2c.head;
+	uint8_t sr1 = I2C->SR1;
+	uint8_t err = I2C->SR2 & (I2C_SR2_OVR | I2C_SR2_AF | I2C_SR2_ARLO | I2C_SR2_BERR);
+	uint8_t sr3;
+
+	if (req == 0)
+	{
+		I2C->ITR = 0;
+		return;
+	}
+
+	if (err)
+	{
+		I2C->SR2 = 0;
+		i2c_end(); // after an error too, the master releases the bus or restarts
+		i2c_done(err);
+		return;
+	}
+
+	if (sr1 & I2C_SR1_SB)
+	{
+		if (req->phase == I2C_WRITE)
+		{
+			I2C->DR = (uint8_t)(req->addr << 1);
+			return;
+		}
+		if      (req->rlen == 1) I2C->CR2 &= (uint8_t)~(I2C_CR2_ACK | I2C_CR2_POS);
+		else if (req->rlen == 2) I2C->CR2 |= I2C_CR2_ACK | I2C_CR2_POS;
+		else                     I2C->CR2  = (uint8_t)((I2C->CR2 & ~I2C_CR2_POS) | I2C_CR2_ACK);
+		I2C->DR = (uint8_t)((req->addr << 1) | 1);
+		return;
+	}
+
+	if (sr1 & I2C_SR1_ADDR)
+	{
+		sr3 = I2C->SR3; // reading SR1 then SR3 clears ADDR
+		(void) sr3;
+		if (req->phase == I2C_START)
+		{
+			req->phase = I2C_READ;
+			if (req->rlen == 1)
+			{
+				i2c_end();                             // NACK already programmed
+				I2C->ITR |= I2C_ITR_ITBUFEN;           // RXNE
+			}
+			else
+			if (req->rlen == 2)
+				I2C->CR2 &= (uint8_t)~I2C_CR2_ACK;     // NACK the second byte (POS), wait for BTF
+			else
+			if (req->rlen > 3)
+				I2C->ITR |= I2C_ITR_ITBUFEN;           // RXNE until three are left, then BTF
+		}
+		else
+		if (req->wlen)
+		{
+			I2C->ITR |= I2C_ITR_ITBUFEN;               // TXE
+		}
+		else
+		{
+			i2c_end();                                 // probe: the slave acknowledged
+			i2c_done(0);
+		}
+		return;
+	}
+
+	if (req->phase == I2C_START)
+		return; // BTF of the write phase stays set until the repeated start
+
+	if (req->phase == I2C_WRITE)
+	{
+		if ((sr1 & I2C_SR1_TXE) && req->pos < req->wlen)
+		{
+			I2C->DR = req->wbuf[req->pos++];
+			if (req->pos == req->wlen)
+				I2C->ITR &= (uint8_t)~I2C_ITR_ITBUFEN; // wait for BTF
+			return;
+		}
+		if (sr1 & I2C_SR1_BTF)
+		{
+			if (req->rlen)
+			{
+				req->pos   = 0;
+				req->phase = I2C_START;
+				I2C->CR2  |= I2C_CR2_START;            // repeated start
+			}
+			else
+			{
+				i2c_end();
+				i2c_done(0);
+			}
+		}
+		return;
+	}
+
+	// I2C_READ
+	if (req->rlen == 1)
+	{
+		if (sr1 & I2C_SR1_RXNE)
+		{
+			req->rbuf[0] = I2C->DR;
+			i2c_done(0);
+		}
+		return;
+	}
+
+	if (req->rlen - req->pos > 3)
+	{
+		if (sr1 & I2C_SR1_RXNE)
+		{
+			req->rbuf[req->pos++] = I2C->DR;
+			if (req->rlen - req->pos == 3)
+				I2C->ITR &= (uint8_t)~I2C_ITR_ITBUFEN; // wait for BTF
+		}
+		return;
+	}
+
+	if (sr1 & I2C_SR1_BTF)
+	{
+		if (req->rlen - req->pos == 3)
+		{
+			I2C->CR2 &= (uint8_t)~I2C_CR2_ACK;         // NACK the last byte
+			req->rbuf[req->pos++] = I2C->DR;
+		}
+		else
+		{
+			i2c_readLast(req);
+		}
+	}
+}
+
+/* -------------------------------------------------------------------------- */
+
+// queue a transaction with the slave at (addr): write (wlen) bytes of (wbuf),
+// then read (rlen) bytes into (rbuf); the buffers must stay valid until the
+// transaction is completed; (sem) is given on completion
+static inline void i2c_transfer( i2c_req_t *req, uint8_t addr, const void *wbuf, uint8_t wlen, void *rbuf, uint8_t rlen, sem_id sem )
+{
+	irq_t cc;
+
+	req->next = 0;
+	req->addr = addr;
+	req->wbuf = (const uint8_t *)wbuf;
+	req->wlen = wlen;
+	req->rbuf = (uint8_t *)rbuf;
+	req->rlen = rlen;
+	req->err  = 0;
+	req->sem  = sem;
+	req->busy = 1;
+
+	cc = irq_lock();
+	while (i2c.head && i2c.stop) // the last transaction queued requested a STOP already
+	{
+		irq_unlock(cc);
+		tsk_yield();
+		cc = irq_lock();
+	}
+	if (i2c.tail) i2c.tail->next = req; else i2c.head = req;
+	i2c.tail = req;
+	if (i2c.head == req) i2c_kick();
+	irq_unlock(cc);
+}
+
+// queue reading (len) bytes from register (reg) of the slave at (addr)
+static inline void i2c_readReg( i2c_req_t *req, uint8_t addr, uint8_t reg, void *buf, uint8_t len, sem_id sem )
+{
+	req->reg = reg;
+	i2c_transfer(req, addr, &req->reg, 1, buf, len, sem);
+}
+
+static inline uint8_t i2c_busy( i2c_req_t *req )
+{
+	return req->busy;
+}
+
+// wait for the transaction (and all queued before it) to complete
+static inline void i2c_wait( i2c_req_t *req )
+{
+	while (req->busy)
+		if (req->sem) sem_wait(req->sem); else tsk_yield();
+}
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__I2C_H__
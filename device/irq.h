@@ -0,0 +1,129 @@
+#ifndef __IRQ_H__
+#define __IRQ_H__
+
+#include <stm8s.h>
+
+// nestable critical sections built on the I1/I0 bits of the CC register
+// and the software priority levels of the interrupt controller (ITC->ISPRx)
+//
+// level 0: main program, nothing masked
+// level 1: interrupts with software priority 1 masked
+// level 2: interrupts with software priority 1 and 2 masked
+// level 3: all maskable interrupts masked (sim)
+//
+// all vectors reset to priority 3; lower the kernel tick and slow peripherals
+// with irq_setPriority, then irq_raise(2) masks them while priority 3
+// handlers (e.g. UART2 RX, vector 21) stay live
+//
+// usage:
+//   irq_t cc = irq_raise(IRQ_LEVEL2);
+//   ...
+//   irq_unlock(cc);
+
+/* -------------------------------------------------------------------------- */
+
+typedef uint8_t irq_t;
+
+#define IRQ_LEVEL0       0
+#define IRQ_LEVEL1       1
+#define IRQ_LEVEL2       2
+#define IRQ_LEVEL3       3
+
+// CC register I1/I0 encoding of cpu level
+#define IRQ_CC( level ) ((level) == 0 ? 0x20 : (level) == 1 ? 0x08 : (level) == 2 ? 0x00 : 0x28)
+// ITC->ISPRx encoding of software priority (level 0 is forbidden)
+#define IRQ_SP( level ) ((level) == 1 ? 0x01 : (level) == 2 ? 0x00 : 0x03)
+
+/* -------------------------------------------------------------------------- */
+
+#if   defined(__CSMC__)
+
+#define irq_get()        ((irq_t)_asm("push cc\npop a\n"))
+#define irq_put( cc )            _asm("push a\npop cc\n", (irq_t)(cc))
+
+#elif defined(__SDCC)
+
+static irq_t irq_get( void ) __naked
+{
+#if defined(__SDCC_MODEL_LARGE)
+	__asm__("push cc\npop a\nretf\n");
+#else
+	__asm__("push cc\npop a\nret\n");
+#endif
+}
+
+static void irq_put( irq_t cc ) __naked
+{
+	(void) cc;
+#if defined(__SDCCCALL) && __SDCCCALL
+	__asm__("push a\npop cc\n");
+#elif defined(__SDCC_MODEL_LARGE)
+	__asm__("ld a, (4, sp)\npush a\npop cc\n");
+#else
+	__asm__("ld a, (3, sp)\npush a\npop cc\n");
+#endif
+#if defined(__SDCC_MODEL_LARGE)
+	__asm__("retf\n");
+#else
+	__asm__("ret\n");
+#endif
+}
+
+#else
+#error Unsupported compiler!
+#endif
+
+/* -------------------------------------------------------------------------- */
+
+// current cpu level decoded from the CC register
+static inline uint8_t irq_level( void )
+{
+	irq_t cc = irq_get() & CPU_CC_I1I0;
+	return cc == 0x20 ? 0 : cc == 0x08 ? 1 : cc == 0x00 ? 2 : 3;
+}
+
+// raise cpu level to (level), never lower it; returns the previous CC value
+static inline irq_t irq_raise( uint8_t level )
+{
+	irq_t cc = irq_get();
+	if (level > irq_level())
+		irq_put((cc & ~CPU_CC_I1I0) | IRQ_CC(level));
+	return cc;
+}
+
+// mask all maskable interrupts; returns the previous CC value
+static inline irq_t irq_lock( void )
+{
+	irq_t cc = irq_get();
+	sim();
+	return cc;
+}
+
+// leave the critical section entered by irq_raise / irq_lock
+static inline void irq_unlock( irq_t cc )
+{
+	irq_put(cc);
+}
+
+/* -------------------------------------------------------------------------- */
+
+// set software priority (1..3) of interrupt vector (irq), numbered as in vectab.c
+// ITC->ISPRx may be written only with all interrupts masked
+static inline void irq_setPriority( uint8_t irq, uint8_t level )
+{
+	volatile uint8_t *spr = &ITC->ISPR1 + (irq >> 2);
+	uint8_t shift = (irq & 3) << 1;
+	irq_t cc = irq_lock();
+	*spr = (*spr & ~(0x03 << shift)) | (IRQ_SP(level) << shift);
+	irq_unlock(cc);
+}
+
+static inline uint8_t irq_getPriority( uint8_t irq )
+{
+	uint8_t sp = ((&ITC->ISPR1)[irq >> 2] >> ((irq & 3) << 1)) & 0x03;
+	return sp == 0x01 ? 1 : sp == 0x00 ? 2 : 3;
+}
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__IRQ_H__
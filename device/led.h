@@ -3,20 +3,21 @@
 
 #include <stm8s.h>
 #include <bitfield.h>
+#include <pin.h>
 
 // led: GPIOD.0
 
+#define   LED_PIN  PIN(GPIOD, 0x01, PIN_LOW)
 #define   LED  BIT(GPIOD->ODR, 0)
 
 static inline void led_init( void )
 {
-	GPIOD->DDR |= 0x01;
-	GPIOD->CR1 |= 0x01;
-	GPIOD->ODR |= 0x01;
+	PIN_OUTPUT(LED_PIN);
+	PIN_OFF(LED_PIN);
 }
 
-static inline void led_set   ( void ) { GPIOD->ODR &= 0xFE; }
-static inline void led_clear ( void ) { GPIOD->ODR |= 0x01; }
-static inline void led_toggle( void ) { GPIOD->ODR ^= 0x01; }
+static inline void led_set   ( void ) { PIN_ON(LED_PIN);     }
+static inline void led_clear ( void ) { PIN_OFF(LED_PIN);    }
+static inline void led_toggle( void ) { PIN_TOGGLE(LED_PIN); }
 
 #endif//__LED_H__
@@ -0,0 +1,174 @@
+#ifndef __MOT_H__
+#define __MOT_H__
+
+#include <os.h>
+#include <irq.h>
+#include <tim.h>
+
+// step pulse generator with table-driven motion profiles
+// every step is one PWM period of MOT_TIM channel 1 (TIM2: PD4, TIM3: PD2): a pulse of
+// MOT_PULSE counts at the start of a period of the step interval; the update
+// interrupt only looks the interval of the next step up in a constant ramp
+// table and preloads the auto-reload register, there is no arithmetic beyond
+// an index comparison
+// a ramp table holds the step intervals (timer counts) from standstill up to
+// the cruise speed; a move of n steps accelerates along the table, cruises at
+// its last interval and decelerates along the table backwards (a short move
+// turns back halfway); the table shape gives the profile: constant
+// acceleration (trapezoid) or limited jerk (S-curve), see ramp.h
+//
+// usage:
+//   MOT();
+//   INTERRUPT_HANDLER(TIM2_UPD_OVF_BRK_IRQHandler, 13) { mot_handler(); }
+//   ...
+//   mot_init();
+//   mot_move(&ramp_trapezoid, 1000, 1, 0);
+//   mot_wait();
+
+#ifndef MOT_TIM
+#define MOT_TIM          2    // step timer (2 or 3), channel 1 drives the step pin
+#endif
+
+#define TIM_CLAIM MOT_TIM
+#include <tim.h>
+#define MOT_TIMER        TIM_REG(MOT_TIM)
+#ifndef MOT_PULSE
+#define MOT_PULSE        10   // step pulse width (timer counts)
+#endif
+
+#define MOT_PSC          4    // timer counts at CPU_FREQUENCY / 16, 1 MHz on the discovery board
+
+/* -------------------------------------------------------------------------- */
+
+typedef struct __mot_ramp
+{
+	const uint16_t *tab;   // step intervals (timer counts), decreasing, all > MOT_PULSE
+	uint16_t        len;
+}	mot_ramp_t;
+
+typedef struct __mot
+{
+	const uint16_t   *tab;
+	uint16_t          acc;   // steps of acceleration (and of deceleration)
+	uint16_t          dec;   // first step of deceleration
+	uint16_t          cnt;   // steps of the move
+	uint16_t          step;  // step being output
+	int8_t            dir;
+	volatile int32_t  pos;   // position (steps)
+	sem_id            sem;   // given at the end of a move, may be 0
+	volatile uint8_t  busy;
+}	mot_t;
+
+extern mot_t mot;
+
+// define the state of the generator
+#define MOT()   mot_t mot
+
+/* -------------------------------------------------------------------------- */
+
+static inline void mot_arr( uint16_t arr )
+{
+	MOT_TIMER->ARRH = (uint8_t)((arr - 1) >> 8);
+	MOT_TIMER->ARRL = (uint8_t)((arr - 1));
+}
+
+static inline void mot_ccr( uint16_t ccr )
+{
+	MOT_TIMER->CCR1H = (uint8_t)(ccr >> 8);
+	MOT_TIMER->CCR1L = (uint8_t)(ccr);
+}
+
+// interval of step (i)
+static inline uint16_t mot_interval( uint16_t i )
+{
+	if (i < mot.acc) return mot.tab[i];
+	if (i < mot.dec) return mot.tab[mot.acc - 1];
+	return mot.tab[mot.cnt - 1 - i];
+}
+
+static inline void mot_init( void )
+{
+	MOT_TIMER->CR1   = TIM2_CR1_ARPE;
+	MOT_TIMER->PSCR  = MOT_PSC;
+	MOT_TIMER->CCMR1 = 0x60 | TIM2_CCMR_OCxPE; // PWM mode 1, preloaded
+	MOT_TIMER->CCER1 = TIM2_CCER1_CC1E;
+	mot_ccr(0);
+	mot.pos  = 0;
+	mot.busy = 0;
+}
+
+// call from the update interrupt handler of MOT_TIM
+// step (step) has just started, with the interval and pulse preloaded before
+static inline void mot_handler( void )
+{
+	uint16_t i;
+
+	MOT_TIMER->SR1 = (uint8_t)~TIM2_SR1_UIF;
+
+	i = ++mot.step;
+	if (i < mot.cnt)
+	{
+		mot.pos += mot.dir;
+		if (i + 1 < mot.cnt) mot_arr(mot_interval(i + 1));
+		else                 mot_ccr(0); // no pulse after the last step
+		return;
+	}
+
+	MOT_TIMER->CR1 &= (uint8_t)~TIM2_CR1_CEN;
+	MOT_TIMER->IER &= (uint8_t)~TIM2_IER_UIE;
+	mot.busy = 0;
+	if (mot.sem) sem_give(mot.sem);
+}
+
+/* -------------------------------------------------------------------------- */
+
+// start a move of (cnt) steps in direction (dir, +1 or -1) along (ramp);
+// the direction pin is up to the application; returns 0 if a move is running
+static inline uint8_t mot_move( const mot_ramp_t *ramp, uint16_t cnt, int8_t dir, sem_id sem )
+{
+	if (mot.busy || cnt == 0) return 0;
+
+	mot.tab  = ramp->tab;
+	mot.acc  = cnt / 2 < ramp->len ? (cnt + 1) / 2 : ramp->len;
+	mot.dec  = cnt - mot.acc;
+	mot.cnt  = cnt;
+	mot.step = 0;
+	mot.dir  = dir;
+	mot.sem  = sem;
+	mot.busy = 1;
+	mot.pos += dir;
+
+	mot_arr(mot_interval(0));
+	mot_ccr(MOT_PULSE);
+	MOT_TIMER->EGR  = TIM2_EGR_UG;                        // step 0 starts with the counter
+	if (cnt > 1) mot_arr(mot_interval(1)); else mot_ccr(0);
+	MOT_TIMER->SR1  = (uint8_t)~TIM2_SR1_UIF;
+	MOT_TIMER->IER |= TIM2_IER_UIE;
+	MOT_TIMER->CR1 |= TIM2_CR1_CEN;
+	return 1;
+}
+
+static inline uint8_t mot_busy( void )
+{
+	return mot.busy;
+}
+
+// wait for the end of the move, on its semaphore if it has one
+static inline void mot_wait( void )
+{
+	while (mot.busy)
+		if (mot.sem) sem_wait(mot.sem); else tsk_yield();
+}
+
+static inline int32_t mot_position( void )
+{
+	int32_t x;
+	irq_t cc = irq_lock();
+	x = mot.pos;
+	irq_unlock(cc);
+	return x;
+}
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__MOT_H__
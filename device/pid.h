@@ -0,0 +1,106 @@
+#ifndef __PID_H__
+#define __PID_H__
+
+#include <dsp.h>
+
+// fixed-point PID controller (Q15 signals and gains), no floating point
+// u = (kp e + ki sum(e) - kd d(y)/dt) * 2^shift, clamped to [min, max]
+// - the derivative acts on the measurement (no kick on setpoint steps) and is
+//   smoothed by a first order low-pass of time constant 2^dk samples (lpf_t)
+// - anti-windup: the integral is clamped to the output range and is frozen
+//   while the output saturates in the direction of the error
+// - gains are Q15 in [0, 1) scaled by 2^shift (shift 0..8), so effective
+//   gains go up to 256; the integral gain is per sample (ki = Ki * Ts)
+// - the derivative filter constant dk is 1..15 (lpf_put); PID() checks dk
+//   and shift at compile time; with gains >= 0 no intermediate result
+//   overflows: the integral stays within 2^31 and the output before
+//   clamping within 3 * 2^15 * 2^shift
+// pid_update is three products of 16-bit operands with 32-bit results, adds,
+// clamps and shifts; the STM8 shifts one bit per step, so the shifts by
+// (shift) and, in lpf_put, by 16 - dk and dk are loops whose length is set
+// by the configuration, not by the data; it never blocks and may be called
+// from a periodic task or directly from a timer interrupt handler; its worst
+// case is a saturated output with a nonzero derivative, timed by
+// test/bench/pid.c (make -C test bench)
+//
+// usage:
+//   PID(pid, Q15(0.5), Q15(0.01), Q15(0.1), 2, 0, Q15(0.99), 3);
+//   ...
+//   pid_reset(&pid, y);
+//   u = pid_update(&pid, sp, y);
+
+/* -------------------------------------------------------------------------- */
+
+typedef struct __pid_ctrl
+{
+	q15_t   kp, ki, kd;  // gains, Q15 scaled by 2^shift
+	uint8_t shift;
+	q15_t   min, max;    // output limits
+	int32_t imin, imax;  // integral limits (Q30, before scaling)
+	int32_t integ;       // integral (Q30, before scaling)
+	q15_t   prev;        // previous measurement
+	lpf_t   d;           // derivative filter
+}	pid_ctrl_t;
+
+#define PID_ASSERT( name, expr ) typedef char name[(expr) ? 1 : -1]
+
+// integral limit (lim) * 2^15 / 2^shift, shifted as unsigned: a negative (lim) is not shifted left
+#define _PID_ILIM( lim, shift ) ((int32_t)((uint32_t)(int32_t)(lim) << (15 - (shift))))
+
+#define _PID_INIT( kp, ki, kd, shift, min, max, dk ) \
+        { kp, ki, kd, shift, min, max, _PID_ILIM(min, shift), _PID_ILIM(max, shift), 0, 0, _LPF_INIT( dk ) }
+
+// define and initialize the controller (pid)
+#define             PID( pid, kp, ki, kd, shift, min, max, dk )                       \
+                    PID_ASSERT( pid##__chk, (shift) <= 8 && (dk) >= 1 && (dk) <= 15 ); \
+                    pid_ctrl_t pid = _PID_INIT( kp, ki, kd, shift, min, max, dk )
+
+#define      static_PID( pid, kp, ki, kd, shift, min, max, dk )                       \
+                    PID_ASSERT( pid##__chk, (shift) <= 8 && (dk) >= 1 && (dk) <= 15 ); \
+             static pid_ctrl_t pid = _PID_INIT( kp, ki, kd, shift, min, max, dk )
+
+/* -------------------------------------------------------------------------- */
+
+// clear the integral and the derivative state, (y) is the current measurement
+static inline void pid_reset( pid_ctrl_t *pid, q15_t y )
+{
+	pid->integ = 0;
+	pid->prev  = y;
+	pid->d.acc = 0;
+}
+
+// one control step with setpoint (sp) and measurement (y); returns the output
+static inline q15_t pid_update( pid_ctrl_t *pid, q15_t sp, q15_t y )
+{
+	q15_t   e = q15_sub(sp, y);
+	q15_t   d = lpf_put(&pid->d, q15_sub(pid->prev, y));
+	int32_t i = pid->integ + (int32_t)pid->ki * e;
+	int32_t u;
+
+	pid->prev = y;
+
+	if      (i > pid->imax) i = pid->imax;
+	else if (i < pid->imin) i = pid->imin;
+
+	u  = ((int32_t)pid->kp * e) >> 15;
+	u += i >> 15;
+	u += ((int32_t)pid->kd * d) >> 15;
+	u  = (int32_t)((uint32_t)u << pid->shift); // |u| < 3 * 2^23
+
+	if (u > pid->max)
+	{
+		if (e <= 0) pid->integ = i; // integrate only out of saturation
+		return pid->max;
+	}
+	if (u < pid->min)
+	{
+		if (e >= 0) pid->integ = i;
+		return pid->min;
+	}
+	pid->integ = i;
+	return (q15_t)u;
+}
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__PID_H__
@@ -0,0 +1,134 @@
+#ifndef __PIN_H__
+#define __PIN_H__
+
+#if defined(__CSMC__) || defined(__RCST7__) || defined(__ICCSTM8__) || defined(__SDCC)
+#include <stm8s.h>
+#else
+#include <stdint.h>
+#endif
+
+// compile-time pin descriptors
+// a pin (or a group of pins of one port) is declared once as a descriptor:
+//   #define LED_PIN  PIN(GPIOD, 0x01, PIN_LOW)   // on when low
+//   #define SEG_PINS PIN(GPIOB, 0xF0, PIN_HIGH)  // group of four pins
+// and every helper takes the descriptor; port, mask and polarity are
+// constants, so single-pin helpers compile to single bit instructions
+// (BSET, BRES, BCPL, BTJT) and a group is updated with one store to ODR:
+//   PIN_OUTPUT(LED_PIN); PIN_ON(LED_PIN); PIN_TOGGLE(LED_PIN);
+//   PIN_WRITE(SEG_PINS, digit << 4);
+// the C++ flavour (host build) is a class template of the port base address,
+// the mask and the polarity with the same operations:
+//   typedef Pin<GPIOD_BaseAddress, 0x01, PIN_LOW> Led;  Led::on();
+// on a host (no STM8 compiler) the ports are plain memory, pin_ports, with
+// the addresses and names of the STM8 (GPIOA..GPIOI); a test defines them
+// once with PIN_PORTS() and sets IDR itself
+
+#define PIN_HIGH         0 // active high
+#define PIN_LOW          1 // active low
+
+#define PIN( port, mask, pol )  port, mask, pol
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __STM8S_H
+
+typedef struct __GPIO_TypeDef
+{
+	volatile uint8_t ODR;
+	volatile uint8_t IDR;
+	volatile uint8_t DDR;
+	volatile uint8_t CR1;
+	volatile uint8_t CR2;
+}	GPIO_TypeDef;
+
+#define GPIOA_BaseAddress       0x5000
+#define GPIOB_BaseAddress       0x5005
+#define GPIOC_BaseAddress       0x500A
+#define GPIOD_BaseAddress       0x500F
+#define GPIOE_BaseAddress       0x5014
+#define GPIOF_BaseAddress       0x5019
+#define GPIOG_BaseAddress       0x501E
+#define GPIOH_BaseAddress       0x5023
+#define GPIOI_BaseAddress       0x5028
+
+#ifdef __cplusplus
+extern "C" GPIO_TypeDef pin_ports[9];
+#else
+extern GPIO_TypeDef pin_ports[9];
+#endif
+
+// define the port registers of the host build
+#define PIN_PORTS()             GPIO_TypeDef pin_ports[9]
+
+#define PIN_PORT( base )        (&pin_ports[((base) - GPIOA_BaseAddress) / sizeof(GPIO_TypeDef)])
+
+#define GPIOA                   PIN_PORT(GPIOA_BaseAddress)
+#define GPIOB                   PIN_PORT(GPIOB_BaseAddress)
+#define GPIOC                   PIN_PORT(GPIOC_BaseAddress)
+#define GPIOD                   PIN_PORT(GPIOD_BaseAddress)
+#define GPIOE                   PIN_PORT(GPIOE_BaseAddress)
+#define GPIOF                   PIN_PORT(GPIOF_BaseAddress)
+#define GPIOG                   PIN_PORT(GPIOG_BaseAddress)
+#define GPIOH                   PIN_PORT(GPIOH_BaseAddress)
+#define GPIOI                   PIN_PORT(GPIOI_BaseAddress)
+
+#else
+
+#define PIN_PORT( base )        ((GPIO_TypeDef *)(base))
+
+#endif//__STM8S_H
+
+/* -------------------------------------------------------------------------- */
+
+#define __PIN_OUTPUT( port, mask, pol )  ((port)->DDR |= (mask), (port)->CR1 |= (mask))
+#define __PIN_INPUT( port, mask, pol )   ((port)->DDR &= (uint8_t)~(mask), (port)->CR1 |= (mask))
+#define __PIN_SET( port, mask, pol )     ((port)->ODR |= (mask))
+#define __PIN_CLR( port, mask, pol )     ((port)->ODR &= (uint8_t)~(mask))
+#define __PIN_ON( port, mask, pol )      ((pol) ? __PIN_CLR(port, mask, pol) : __PIN_SET(port, mask, pol))
+#define __PIN_OFF( port, mask, pol )     ((pol) ? __PIN_SET(port, mask, pol) : __PIN_CLR(port, mask, pol))
+#define __PIN_TOGGLE( port, mask, pol )  ((port)->ODR ^= (mask))
+#define __PIN_GET( port, mask, pol )     ((uint8_t)(((pol) ? ~(port)->IDR : (port)->IDR) & (mask)))
+#define __PIN_WRITE( port, mask, pol, v ) \
+        ((port)->ODR = (uint8_t)(((port)->ODR & ~(mask)) | (((pol) ? ~(v) : (v)) & (mask))))
+
+// configure as push-pull output / as input with pull-up
+#define PIN_OUTPUT( ... )      __PIN_OUTPUT(__VA_ARGS__)
+#define PIN_INPUT( ... )       __PIN_INPUT(__VA_ARGS__)
+// drive to the active / inactive level
+#define PIN_ON( ... )          __PIN_ON(__VA_ARGS__)
+#define PIN_OFF( ... )         __PIN_OFF(__VA_ARGS__)
+#define PIN_TOGGLE( ... )      __PIN_TOGGLE(__VA_ARGS__)
+// active pins of the descriptor (mask bits), read from IDR
+#define PIN_GET( ... )         __PIN_GET(__VA_ARGS__)
+// set the active pins of a group to the mask bits of (v), one store
+#define PIN_WRITE( ... )       __PIN_WRITE(__VA_ARGS__)
+
+/* -------------------------------------------------------------------------- */
+
+#ifdef __cplusplus
+
+template<unsigned long base, unsigned char mask, unsigned char pol = PIN_HIGH>
+struct Pin
+{
+	static constexpr unsigned long address  = base;
+	static constexpr unsigned char bits     = mask;
+	static constexpr unsigned char polarity = pol;
+
+	static constexpr GPIO_TypeDef *port()                 { return PIN_PORT(base); }
+	// ODR bits driving the active pins of (v) to their active level
+	static constexpr unsigned char level( unsigned char v ) { return (unsigned char)((pol ? ~v : v) & mask); }
+
+	static void output()             { __PIN_OUTPUT(port(), mask, pol); }
+	static void input()              { __PIN_INPUT (port(), mask, pol); }
+	static void on()                 { __PIN_ON    (port(), mask, pol); }
+	static void off()                { __PIN_OFF   (port(), mask, pol); }
+	static void toggle()             { __PIN_TOGGLE(port(), mask, pol); }
+	static unsigned char get()       { return __PIN_GET(port(), mask, pol); }
+	static void write( unsigned char v ) { __PIN_WRITE(port(), mask, pol, v); }
+};
+
+#endif//__cplusplus
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__PIN_H__
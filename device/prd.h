@@ -0,0 +1,120 @@
+#ifndef __PRD_H__
+#define __PRD_H__
+
+#include <os.h>
+#include <tick.h>
+
+// drift-free periodic delay (delay until the next absolute deadline)
+// the object keeps the last deadline of the task, so the execution time of
+// the task body and of the context switch does not accumulate
+// the task sleeps on the absolute deadline (tsk_sleepUntil), so a tick landing
+// between reading the time and going to sleep does not delay the wake-up
+// a deadline already passed is counted as an overrun and the following
+// deadlines stay in phase with the original cadence (missed periods are
+// skipped, not bursted); a deadline reached exactly is not an overrun
+// the cadence starts at the first prd_wait, or at prd_start
+// lateness of every wake-up is collected in a histogram (in ticks), printed
+// with the overrun count by prd_dump through any string output, e.g. uart.h
+// the period must stay below TICK_RANGE (tick.h)
+//
+// usage:
+//   PRD(prd, SEC);
+//   OS_TSK_DEF(tsk) { prd_wait(prd); ... }
+//   ...
+//   prd_dump(prd, uart_puts);
+
+#ifndef PRD_BINS
+#define PRD_BINS         8 // histogram bins: 0, 1, ... PRD_BINS-2, >= PRD_BINS-1 ticks late
+#endif
+
+/* -------------------------------------------------------------------------- */
+
+typedef struct __prd
+{
+	cnt_t    next;           // current deadline
+	cnt_t    period;
+	uint8_t  run;            // cadence started
+	uint16_t overrun;        // missed deadlines (saturates)
+	uint16_t hist[PRD_BINS]; // wake-up lateness histogram (saturates)
+}	prd_t, *prd_id;
+
+/* -------------------------------------------------------------------------- */
+
+#define _PRD_INIT( period ) { 0, period, 0, 0, { 0 } }
+
+// define a periodic delay object (prd) with period (period) in ticks
+#define             PRD( prd, period )                      \
+                    prd_t prd##__prd = _PRD_INIT( period ); \
+                    prd_id prd = & prd##__prd
+
+#define      static_PRD( prd, period )                      \
+             static prd_t prd##__prd = _PRD_INIT( period ); \
+             static prd_id prd = & prd##__prd
+
+/* -------------------------------------------------------------------------- */
+
+// restart the cadence from now
+static inline void prd_start( prd_id prd )
+{
+	prd->next = sys_time();
+	prd->run  = 1;
+}
+
+// sleep until the next deadline
+static inline void prd_wait( prd_id prd )
+{
+	cnt_t now;
+	cnt_t late;
+
+	if (!prd->run) prd_start(prd);
+
+	now = sys_time();
+	prd->next += prd->period;
+	while (tick_before(prd->next, now))
+	{
+		if (prd->overrun < 0xFFFF) prd->overrun++;
+		prd->next += prd->period;
+	}
+
+	tsk_sleepUntil(prd->next);
+
+	late = sys_time() - prd->next;
+	if (late > PRD_BINS - 1) late = PRD_BINS - 1;
+	if (prd->hist[late] < 0xFFFF) prd->hist[late]++;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static inline void prd_putNum( void (*puts)( const char * ), uint16_t val )
+{
+	char buf[6];
+	char *p = buf + sizeof(buf);
+	*--p = 0;
+	do { *--p = (char)('0' + val % 10); val /= 10; } while (val);
+	puts(p);
+}
+
+// print the lateness histogram ("late n: count", the last bin ">= n") and the
+// overrun count with (puts), then clear them
+static inline void prd_dump( prd_id prd, void (*puts)( const char * ) )
+{
+	uint8_t i;
+
+	for (i = 0; i < PRD_BINS; i++)
+	{
+		puts(i < PRD_BINS - 1 ? "late " : "late >= ");
+		prd_putNum(puts, i);
+		puts(": ");
+		prd_putNum(puts, prd->hist[i]);
+		puts("\r\n");
+		prd->hist[i] = 0;
+	}
+	puts("overrun: ");
+	prd_putNum(puts, prd->overrun);
+	puts("\r\n");
+	prd->overrun = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__PRD_H__
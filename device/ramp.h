@@ -0,0 +1,65 @@
+#ifndef __RAMP_H__
+#define __RAMP_H__
+
+#include <mot.h>
+
+// constant ramp tables for mot.h, step intervals in timer counts (1 us),
+// from standstill to 5000 steps/s (200 us), generated offline:
+// ramp_trapezoid: constant acceleration of 50000 steps/s^2, interval of step k
+//                 is sqrt(2/a) * (sqrt(k+1) - sqrt(k)) (exact step times)
+// ramp_scurve:    acceleration rising with a jerk of 3e6 steps/s^3 up to
+//                 70000 steps/s^2 and falling to 0 at the cruise speed,
+//                 integrated numerically
+// the tables are placed in program memory (.const); include this header in
+// one translation unit only
+
+/* -------------------------------------------------------------------------- */
+
+static const uint16_t ramp_trapezoid_tab[] =
+{
+	 6325,  2620,  2010,  1695,  1493,  1350,  1241,  1155,  1085,  1026,   976,   933,   895,   861,   831,   803,
+	  779,   756,   735,   716,   698,   682,   667,   652,   639,   626,   614,   603,   592,   582,   573,   563,
+	  555,   546,   538,   531,   523,   516,   510,   503,   497,   491,   485,   479,   474,   469,   464,   459,
+	  454,   449,   445,   441,   436,   432,   428,   424,   421,   417,   413,   410,   407,   403,   400,   397,
+	  394,   391,   388,   385,   382,   379,   377,   374,   371,   369,   366,   364,   362,   359,   357,   355,
+	  352,   350,   348,   346,   344,   342,   340,   338,   336,   334,   332,   331,   329,   327,   325,   324,
+	  322,   320,   319,   317,   315,   314,   312,   311,   309,   308,   306,   305,   304,   302,   301,   299,
+	  298,   297,   296,   294,   293,   292,   290,   289,   288,   287,   286,   285,   283,   282,   281,   280,
+	  279,   278,   277,   276,   275,   274,   273,   272,   271,   270,   269,   268,   267,   266,   265,   264,
+	  263,   262,   261,   260,   260,   259,   258,   257,   256,   255,   254,   254,   253,   252,   251,   250,
+	  250,   249,   248,   247,   247,   246,   245,   244,   244,   243,   242,   241,   241,   240,   239,   239,
+	  238,   237,   237,   236,   235,   235,   234,   233,   233,   232,   232,   231,   230,   230,   229,   229,
+	  228,   227,   227,   226,   226,   225,   224,   224,   223,   223,   222,   222,   221,   221,   220,   220,
+	  219,   218,   218,   217,   217,   216,   216,   215,   215,   214,   214,   213,   213,   212,   212,   212,
+	  211,   211,   210,   210,   209,   209,   208,   208,   207,   207,   207,   206,   206,   205,   205,   204,
+	  204,   203,   203,   203,   202,   202,   201,   201,   201,   200,
+};
+
+static const mot_ramp_t ramp_trapezoid = { ramp_trapezoid_tab, sizeof(ramp_trapezoid_tab) / sizeof(*ramp_trapezoid_tab) };
+
+/* -------------------------------------------------------------------------- */
+
+static const uint16_t ramp_scurve_tab[] =
+{
+	12599,  3275,  2297,  1829,  1544,  1350,  1207,  1100,  1017,   951,   896,   849,   809,   774,   744,   717,
+	  692,   670,   650,   632,   615,   599,   585,   571,   558,   547,   536,   525,   515,   506,   497,   489,
+	  481,   473,   466,   459,   452,   446,   440,   434,   428,   423,   418,   413,   408,   403,   399,   394,
+	  390,   386,   382,   378,   375,   371,   367,   364,   361,   357,   354,   351,   348,   345,   342,   340,
+	  337,   334,   332,   329,   327,   324,   322,   320,   317,   315,   313,   311,   309,   307,   305,   303,
+	  301,   299,   297,   295,   294,   292,   290,   288,   287,   285,   284,   282,   280,   279,   277,   276,
+	  274,   273,   272,   270,   269,   267,   266,   265,   263,   262,   261,   260,   259,   257,   256,   255,
+	  254,   253,   252,   250,   249,   248,   247,   246,   245,   244,   243,   242,   241,   240,   239,   238,
+	  237,   236,   235,   235,   234,   233,   232,   231,   231,   230,   229,   228,   228,   227,   226,   226,
+	  225,   224,   224,   223,   222,   222,   221,   221,   220,   219,   219,   218,   218,   217,   217,   216,
+	  216,   215,   215,   215,   214,   214,   213,   213,   212,   212,   212,   211,   211,   211,   210,   210,
+	  210,   209,   209,   208,   208,   208,   208,   207,   207,   207,   207,   206,   206,   206,   205,   205,
+	  205,   205,   205,   204,   204,   204,   204,   203,   203,   203,   203,   203,   203,   202,   202,   202,
+	  202,   202,   202,   202,   202,   201,   201,   201,   201,   201,   201,   201,   201,   201,   201,   201,
+	  200,
+};
+
+static const mot_ramp_t ramp_scurve = { ramp_scurve_tab, sizeof(ramp_scurve_tab) / sizeof(*ramp_scurve_tab) };
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__RAMP_H__
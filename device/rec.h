@@ -0,0 +1,267 @@
+#ifndef __REC_H__
+#define __REC_H__
+
+#include <eep.h>
+
+// wear-levelled, log-structured record store in the data EEPROM
+// the EEPROM is split into pages (blocks of 128 bytes) used as a circular log;
+// every page starts with a header (magic, sequence number) followed by records
+// (key, len, data...), a key of 0 terminates the page (erased EEPROM reads 0)
+// a new version of a key is appended, never written in place; when the head
+// page is full the next free page is opened and the oldest page is compacted
+// (its live records are copied to the head) so that one page always stays free
+// at boot only the page headers are scanned: the head is the valid page with
+// the highest sequence number, the tail the oldest page of the valid run behind
+// it; if every page is valid, power failed during a compaction (after the new
+// head was opened, before the tail was invalidated) and rec_init finishes it
+// every step is safe against power failure: a record is validated by its key,
+// written last, and a page by its header, written after its first key is
+// cleared; compaction copies only records not found in newer pages, so it can
+// be restarted any number of times
+// lookups walk the records in place through the memory-mapped EEPROM, with no
+// copy in RAM
+// writes go through the asynchronous writer (eep.h) and must be issued from
+// a single task; live data must fit in (REC_PAGES - 2) pages
+// the log takes the top REC_PAGES pages, the bottom of the EEPROM is left to
+// variables the linker places in the .eeprom segment (e.g. cfg.h)
+//
+// usage:
+//   EEP();
+//   REC();
+//   ...
+//   eep_init();
+//   rec_init();
+//   rec_put(KEY_COUNTER, &counter, sizeof(counter));
+//   const uint32_t *p = (const uint32_t *)rec_get(KEY_COUNTER, 0);
+
+#define REC_PAGE         128  // data EEPROM block size
+#ifndef REC_PAGES
+#define REC_PAGES        6    // pages at the top of the data EEPROM used by the log (__EEP_rec in script.lkf)
+#endif
+#define REC_BASE       ((EEP_SIZE) - (REC_PAGES) * (REC_PAGE)) // offset of the log
+#define REC_HDR          4    // page header: 0xA5, seq (lo, hi), 0x5A
+#define REC_MAX        ((REC_PAGE) - (REC_HDR) - 2) // max record data size
+
+/* -------------------------------------------------------------------------- */
+
+typedef struct __rec
+{
+	uint8_t  head; // page being appended
+	uint8_t  tail; // oldest page in use
+	uint8_t  off;  // write offset in the head page
+	uint16_t seq;  // sequence number of the head page
+}	rec_t;
+
+extern rec_t rec;
+
+// define the state of the store
+#define REC()   rec_t rec = { 0, 0, 0, 0 }
+
+/* -------------------------------------------------------------------------- */
+
+static inline const uint8_t *rec_page( uint8_t page )
+{
+	return (const uint8_t *)(EEP_START + REC_BASE + (uint16_t)page * REC_PAGE);
+}
+
+static inline uint8_t rec_next( uint8_t page )
+{
+	return (uint8_t)((page + 1) % REC_PAGES);
+}
+
+static inline uint8_t rec_prev( uint8_t page )
+{
+	return (uint8_t)((page + REC_PAGES - 1) % REC_PAGES);
+}
+
+static inline uint8_t rec_valid( uint8_t page )
+{
+	const uint8_t *p = rec_page(page);
+	return p[0] == 0xA5 && p[3] == 0x5A;
+}
+
+static inline uint16_t rec_seq( uint8_t page )
+{
+	const uint8_t *p = rec_page(page);
+	return p[1] | ((uint16_t)p[2] << 8);
+}
+
+// offset of the end of records in (page)
+static inline uint8_t rec_end( uint8_t page )
+{
+	const uint8_t *p = rec_page(page);
+	uint8_t off = REC_HDR;
+	while (off + 2 <= REC_PAGE && p[off] != 0 && off + 2 + p[off + 1] <= REC_PAGE)
+		off += 2 + p[off + 1];
+	return off;
+}
+
+// true if the record at (off) of page (p) is superseded later in the same page
+static inline uint8_t rec_shadowed( const uint8_t *p, uint8_t off )
+{
+	uint8_t key = p[off];
+	for (off += 2 + p[off + 1]; off + 2 <= REC_PAGE && p[off] != 0 && off + 2 + p[off + 1] <= REC_PAGE; off += 2 + p[off + 1])
+		if (p[off] == key) return 1;
+	return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+// newest record of (key), or 0
+static inline const uint8_t *rec_find( uint8_t key )
+{
+	uint8_t page = rec.head;
+	uint8_t cnt;
+
+	for (cnt = REC_PAGES; cnt; cnt--)
+	{
+		const uint8_t *p = rec_page(page);
+		const uint8_t *r = 0;
+		uint8_t off;
+
+		if (!rec_valid(page)) break;
+		for (off = REC_HDR; off + 2 <= REC_PAGE && p[off] != 0 && off + 2 + p[off + 1] <= REC_PAGE; off += 2 + p[off + 1])
+			if (p[off] == key) r = p + off;
+		if (r) return r;
+		if (page == rec.tail) break;
+		page = rec_prev(page);
+	}
+
+	return 0;
+}
+
+// data of the newest record of (key) read in place, or 0 if absent or deleted
+static inline const void *rec_get( uint8_t key, uint8_t *len )
+{
+	const uint8_t *r = rec_find(key);
+	if (r == 0 || r[1] == 0) return 0;
+	if (len) *len = r[1];
+	return r + 2;
+}
+
+/* -------------------------------------------------------------------------- */
+
+// append a record at the write offset of the head page (the caller checked it fits)
+static inline void rec_append( uint8_t key, const void *data, uint8_t len )
+{
+	static eep_req_t req[4];
+	static uint8_t hdr[2];
+	static const uint8_t end = 0;
+	uint16_t addr = REC_BASE + (uint16_t)rec.head * REC_PAGE + rec.off;
+
+	hdr[0] = key;
+	hdr[1] = len;
+	// data first, then the terminator behind it, then the key validating it
+	eep_write(&req[0], addr + 1, &hdr[1], 1);
+	eep_write(&req[1], addr + 2, data, len);
+	if (rec.off + 2 + len < REC_PAGE)
+		eep_write(&req[2], addr + 2 + len, &end, 1);
+	eep_write(&req[3], addr, &hdr[0], 1);
+	eep_wait(&req[3]);
+	rec.off += 2 + len;
+}
+
+// copy the live records of the oldest page to the head, then invalidate it
+static inline void rec_compact( void )
+{
+	static eep_req_t req;
+	static const uint8_t end = 0;
+	uint8_t old = rec.tail;
+	const uint8_t *p = rec_page(old);
+	uint8_t off;
+
+	rec.tail = rec_next(old); // the copies must not find the originals
+	for (off = REC_HDR; off + 2 <= REC_PAGE && p[off] != 0 && off + 2 + p[off + 1] <= REC_PAGE; off += 2 + p[off + 1])
+	{
+		if (p[off + 1] == 0) continue; // deleted, nothing older to shadow
+		if (rec_shadowed(p, off)) continue; // superseded in the same page
+		if (rec_find(p[off]) != 0) continue; // superseded in a newer page (or copied before a power failure)
+		rec_append(p[off], p + off + 2, p[off + 1]);
+	}
+
+	eep_write(&req, REC_BASE + (uint16_t)old * REC_PAGE, &end, 1); // invalidate the header
+	eep_wait(&req);
+}
+
+// open the next free page and compact the oldest one if the log went full circle
+static inline void rec_open( void )
+{
+	static eep_req_t req[2];
+	static uint8_t hdr[REC_HDR];
+	static const uint8_t end = 0;
+	uint8_t page = rec_next(rec.head);
+	uint16_t addr = REC_BASE + (uint16_t)page * REC_PAGE;
+	uint8_t empty = !rec_valid(rec.head);
+
+	rec.seq++;
+	hdr[0] = 0xA5;
+	hdr[1] = (uint8_t)(rec.seq);
+	hdr[2] = (uint8_t)(rec.seq >> 8);
+	hdr[3] = 0x5A;
+	eep_write(&req[0], addr + REC_HDR, &end, 1);
+	eep_write(&req[1], addr, hdr, REC_HDR);
+	eep_wait(&req[1]);
+
+	rec.head = page;
+	rec.off  = REC_HDR;
+	if (empty) { rec.tail = page; return; }
+
+	if (rec_valid(rec_next(page))) // no free page left, compact the oldest one
+		rec_compact();
+}
+
+/* -------------------------------------------------------------------------- */
+
+static inline void rec_init( void )
+{
+	uint8_t head = REC_PAGES;
+	uint8_t page;
+
+	for (page = 0; page < REC_PAGES; page++)
+		if (rec_valid(page) && (head == REC_PAGES || (int16_t)(rec_seq(page) - rec_seq(head)) > 0))
+			head = page;
+
+	if (head == REC_PAGES) // empty (or unformatted) store
+	{
+		rec.head = rec.tail = REC_PAGES - 1;
+		rec.off  = REC_PAGE;
+		rec.seq  = 0;
+		return;
+	}
+
+	rec.head = head;
+	rec.off  = rec_end(head);
+	rec.seq  = rec_seq(head);
+	for (page = head; rec_valid(rec_prev(page)) && rec_prev(page) != head; page = rec_prev(page));
+	rec.tail = page;
+
+	if (page == rec_next(head)) // every page valid: finish the interrupted compaction
+		rec_compact();
+}
+
+// store (len) bytes of (data) as the newest version of (key: 1..255)
+// len of 0 deletes the key; returns 0 if the store is full
+static inline uint8_t rec_put( uint8_t key, const void *data, uint8_t len )
+{
+	uint8_t cnt;
+
+	if (key == 0 || len > REC_MAX) return 0;
+
+	for (cnt = REC_PAGES; rec.off + 2 + len > REC_PAGE; cnt--)
+	{
+		if (cnt == 0) return 0;
+		rec_open();
+	}
+
+	rec_append(key, data, len);
+	return 1;
+}
+
+static inline uint8_t rec_del( uint8_t key )
+{
+	return rec_put(key, 0, 0);
+}
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__REC_H__
@@ -0,0 +1,124 @@
+#ifndef __RING_H__
+#define __RING_H__
+
+#include <stdint.h>
+
+// lock-free single-producer / single-consumer byte ring buffer
+// head and tail are free-running single bytes, so every access to them is
+// naturally atomic on STM8 and neither side needs sim / rim
+// the producer only writes head, the consumer only writes tail
+// the storage is volatile, so the compiler keeps every payload access on its
+// side of the index update that publishes or releases it
+// size must be a power of two between 2 and 128
+
+/* -------------------------------------------------------------------------- */
+
+typedef struct __ring
+{
+	volatile uint8_t head;  // next position to write (producer)
+	volatile uint8_t tail;  // next position to read  (consumer)
+	         uint8_t mask;  // size - 1
+	volatile uint8_t*data;
+}	ring_t, *ring_id;
+
+/* -------------------------------------------------------------------------- */
+
+#define RING_ASSERT( name, expr ) typedef char name[(expr) ? 1 : -1]
+
+#define RING_SIZE_OK( size )  ((size) >= 2 && (size) <= 128 && ((size) & ((size) - 1)) == 0)
+
+#define _RING_INIT( size, data ) { 0, 0, (uint8_t)((size) - 1), data }
+
+// define and initialize a ring buffer (rng) of (size) bytes
+#define             RING( rng, size )                                 \
+                    RING_ASSERT( rng##__chk, RING_SIZE_OK(size) );    \
+                    uint8_t rng##__buf[size];                          \
+                    ring_t  rng##__ring = _RING_INIT( size, rng##__buf ); \
+                    ring_id rng = & rng##__ring
+
+#define      static_RING( rng, size )                                 \
+                    RING_ASSERT( rng##__chk, RING_SIZE_OK(size) );    \
+             static uint8_t rng##__buf[size];                          \
+             static ring_t  rng##__ring = _RING_INIT( size, rng##__buf ); \
+             static ring_id rng = & rng##__ring
+
+/* -------------------------------------------------------------------------- */
+
+static inline uint8_t ring_count( ring_id r ) { return (uint8_t)(r->head - r->tail); }
+static inline uint8_t ring_space( ring_id r ) { return (uint8_t)(r->mask + 1 - ring_count(r)); }
+static inline uint8_t ring_empty( ring_id r ) { return r->head == r->tail; }
+static inline uint8_t ring_full ( ring_id r ) { return ring_count(r) > r->mask; }
+
+/* -------------------------------------------------------------------------- */
+// producer side
+
+static inline uint8_t ring_put( ring_id r, uint8_t c )
+{
+	uint8_t h = r->head;
+	if ((uint8_t)(h - r->tail) > r->mask) return 0;
+	r->data[h & r->mask] = c;
+	r->head = h + 1; // publish after the data is stored
+	return 1;
+}
+
+// contiguous free area starting at the write position; returns its length
+static inline uint8_t ring_putSpan( ring_id r, volatile uint8_t **ptr )
+{
+	uint8_t h = r->head & r->mask;
+	uint8_t n = r->mask + 1 - h;
+	uint8_t s = ring_space(r);
+	*ptr = r->data + h;
+	return s < n ? s : n;
+}
+
+// publish (cnt) bytes previously written through ring_putSpan
+static inline void ring_commit( ring_id r, uint8_t cnt ) { r->head += cnt; }
+
+static inline uint8_t ring_write( ring_id r, const uint8_t *buf, uint8_t len )
+{
+	uint8_t h = r->head;
+	uint8_t n = ring_space(r);
+	if (len > n) len = n;
+	for (n = len; n; n--, h++) r->data[h & r->mask] = *buf++;
+	r->head = h;
+	return len;
+}
+
+/* -------------------------------------------------------------------------- */
+// consumer side
+
+static inline uint8_t ring_get( ring_id r, uint8_t *c )
+{
+	uint8_t t = r->tail;
+	if (t == r->head) return 0;
+	*c = r->data[t & r->mask];
+	r->tail = t + 1; // release after the data is fetched
+	return 1;
+}
+
+// contiguous filled area starting at the read position; returns its length
+static inline uint8_t ring_getSpan( ring_id r, const volatile uint8_t **ptr )
+{
+	uint8_t t = r->tail & r->mask;
+	uint8_t n = r->mask + 1 - t;
+	uint8_t c = ring_count(r);
+	*ptr = r->data + t;
+	return c < n ? c : n;
+}
+
+// release (cnt) bytes previously read through ring_getSpan
+static inline void ring_consume( ring_id r, uint8_t cnt ) { r->tail += cnt; }
+
+static inline uint8_t ring_read( ring_id r, uint8_t *buf, uint8_t len )
+{
+	uint8_t t = r->tail;
+	uint8_t n = ring_count(r);
+	if (len > n) len = n;
+	for (n = len; n; n--, t++) *buf++ = r->data[t & r->mask];
+	r->tail = t;
+	return len;
+}
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__RING_H__
@@ -0,0 +1,250 @@
+#ifndef __SPI_H__
+#define __SPI_H__
+
+#include <os.h>
+#include <irq.h>
+
+// spi: SPI master (SCK: PC5, MOSI: PC6, MISO: PC7), queued transactions
+// a transaction selects its device with a chip-select pin (active low), shifts
+// (len) bytes out of (tx) and into (rx) and deselects the device; tasks queue
+// transactions and wait on a semaphore given from the interrupt handler
+// the transfer is driven by the interrupts, one step each and no waiting in
+// the handler: RXNE takes the received byte, TXE refills DR while fewer than
+// SPI_DEPTH bytes are in flight (TXIE is enabled only while it may refill)
+// with two bytes in flight (one in the shift register, one in DR) the bytes go
+// out back to back, but each received byte must be read within one byte time
+// or the next one is lost (overrun); that holds only at a slow enough SCK, so
+// the default depth is 2 from fCPU/16 down and 1 above, where every byte waits
+// for the handler
+// at the default 8 MHz SCK (SPI_BR 0) a byte lasts 16 CPU cycles, less than
+// the interrupt entry, the handler and IRET take, so the interrupts cannot
+// transfer back to back there: each byte is followed by a gap of one handler
+// run; continuous transfer at 8 MHz needs polling: a transaction of up to
+// SPI_POLL bytes queued on an idle bus is shifted by spi_transfer itself,
+// with interrupts masked and two bytes in flight; its loop has 16 cycles per
+// byte to read one byte and write the next (32 at SPI_BR 1), a slower loop
+// leaves gaps but never overruns; longer or queued transactions go through
+// the interrupts
+//
+// usage:
+//   SPI_DEF();
+//   INTERRUPT_HANDLER(SPI_IRQHandler, 10) { spi_handler(); }
+//   OS_SEM(done, 0, semBinary);
+//   ...
+//   spi_init();
+//   spi_initCS(GPIOE, 0x20);
+//   spi_transfer(&req, GPIOE, 0x20, cmd, buf, sizeof(buf), done);
+//   spi_wait(&req);
+
+#ifndef SPI_BR
+#define SPI_BR           0  // SCK = fCPU / 2^(SPI_BR+1), 8 MHz at 16 MHz
+#endif
+#ifndef SPI_MODE
+#define SPI_MODE         0  // CPOL:CPHA
+#endif
+#ifndef SPI_DEPTH
+#define SPI_DEPTH       ((SPI_BR) >= 3 ? 2 : 1) // bytes in flight, 1 or 2
+#endif
+#ifndef SPI_POLL
+#define SPI_POLL        ((SPI_BR) >= 3 ? 0 : 4) // longest transaction shifted by polling, 0: none
+#endif
+#ifndef SPI_DUMMY
+#define SPI_DUMMY        0xFF // sent when a transaction has no transmit buffer
+#endif
+
+/* -------------------------------------------------------------------------- */
+
+typedef struct __spi_req
+{
+	struct __spi_req *next;
+	GPIO_TypeDef     *cs;    // port of the chip-select pin
+	uint8_t           pin;   // chip-select pin mask
+	const uint8_t    *tx;    // 0: send SPI_DUMMY
+	uint8_t          *rx;    // 0: discard
+	uint16_t          len;
+	uint16_t          txn;   // bytes written to DR
+	uint16_t          rxn;   // bytes read from DR
+	sem_id            sem;   // given on completion, may be 0
+	volatile uint8_t  busy;
+}	spi_req_t;
+
+typedef struct __spi
+{
+	spi_req_t * volatile head;
+	spi_req_t *          tail;
+}	spi_t;
+
+extern spi_t spi;
+
+// define the state of the driver
+#define SPI_DEF()   spi_t spi = { 0, 0 }
+
+/* -------------------------------------------------------------------------- */
+
+static inline void spi_init( void )
+{
+	SPI->CR2 = SPI_CR2_SSM | SPI_CR2_SSI;
+	SPI->CR1 = SPI_CR1_MSTR | (uint8_t)((SPI_BR) << 3) | (uint8_t)(SPI_MODE);
+	SPI->ICR = SPI_ICR_RXEI;
+	SPI->CR1 |= SPI_CR1_SPE;
+}
+
+// configure a chip-select pin: push-pull output, fast, deselected
+static inline void spi_initCS( GPIO_TypeDef *port, uint8_t pin )
+{
+	port->ODR |= pin;
+	port->DDR |= pin;
+	port->CR1 |= pin;
+	port->CR2 |= pin;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static inline void spi_send( spi_req_t *req )
+{
+	SPI->DR = req->tx ? req->tx[req->txn] : SPI_DUMMY;
+	req->txn++;
+}
+
+// enable TXIE only while the transaction (req) may refill DR
+static inline void spi_irq( spi_req_t *req )
+{
+	if (req && req->txn < req->len && (uint16_t)(req->txn - req->rxn) < SPI_DEPTH)
+		SPI->ICR = SPI_ICR_RXEI | SPI_ICR_TXEI;
+	else
+		SPI->ICR = SPI_ICR_RXEI;
+}
+
+static inline void spi_done( spi_req_t *req )
+{
+	spi.head = req->next;
+	if (spi.head == 0) spi.tail = 0;
+	req->busy = 0;
+	if (req->sem) sem_give(req->sem);
+}
+
+// select the device of the next transaction and start it; called with interrupts masked
+static inline void spi_kick( void )
+{
+	spi_req_t *req;
+
+	while ((req = spi.head) != 0)
+	{
+		if (req->len)
+		{
+			req->cs->ODR &= (uint8_t)~req->pin;
+			spi_send(req);
+			spi_irq(req);
+			return;
+		}
+
+		spi_done(req);
+	}
+
+	spi_irq(0);
+}
+
+// call from SPI_IRQHandler
+static inline void spi_handler( void )
+{
+	spi_req_t *req = spi.head;
+	uint8_t c;
+
+	if (SPI->SR & SPI_SR_RXNE)
+	{
+		c = SPI->DR;
+		if (req == 0) { spi_irq(0); return; }
+		if (req->rx) req->rx[req->rxn] = c;
+		if (++req->rxn == req->len)
+		{
+			req->cs->ODR |= req->pin;
+			spi_done(req);
+			spi_kick();
+			return;
+		}
+	}
+
+	if (req == 0) { spi_irq(0); return; }
+	if (req->txn < req->len && (uint16_t)(req->txn - req->rxn) < SPI_DEPTH && (SPI->SR & SPI_SR_TXE))
+		spi_send(req);
+	spi_irq(req);
+}
+
+// shift the whole transaction (req) by polling, two bytes in flight; called
+// with interrupts masked, on an idle bus, with (req->len) nonzero
+static inline void spi_poll( spi_req_t *req )
+{
+	const uint8_t *tx = req->tx;
+	uint8_t       *rx = req->rx;
+	uint16_t       n  = req->len;
+	uint8_t c;
+
+	req->cs->ODR &= (uint8_t)~req->pin;
+	SPI->DR = tx ? *tx++ : SPI_DUMMY;
+	while (n--)
+	{
+		if (n)
+		{
+			while ((SPI->SR & SPI_SR_TXE) == 0);
+			SPI->DR = tx ? *tx++ : SPI_DUMMY;
+		}
+		while ((SPI->SR & SPI_SR_RXNE) == 0);
+		c = SPI->DR;
+		if (rx) *rx++ = c;
+	}
+	req->cs->ODR |= req->pin;
+	req->txn  = req->len;
+	req->rxn  = req->len;
+	req->busy = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+// queue a transaction of (len) bytes on the device selected by (pin) of (cs);
+// (tx) and (rx) may be the same buffer, or 0; the buffers must stay valid
+// until the transaction is completed; (sem) is given on completion; up to
+// SPI_POLL bytes on an idle bus are transferred before it returns
+static inline void spi_transfer( spi_req_t *req, GPIO_TypeDef *cs, uint8_t pin, const void *tx, void *rx, uint16_t len, sem_id sem )
+{
+	irq_t cc;
+
+	req->next = 0;
+	req->cs   = cs;
+	req->pin  = pin;
+	req->tx   = (const uint8_t *)tx;
+	req->rx   = (uint8_t *)rx;
+	req->len  = len;
+	req->txn  = 0;
+	req->rxn  = 0;
+	req->sem  = sem;
+	req->busy = 1;
+
+	cc = irq_lock();
+	if (spi.head == 0 && len && len <= SPI_POLL)
+	{
+		spi_poll(req);
+		irq_unlock(cc);
+		if (sem) sem_give(sem);
+		return;
+	}
+	if (spi.tail) spi.tail->next = req; else spi.head = req;
+	spi.tail = req;
+	if (spi.head == req) spi_kick();
+	irq_unlock(cc);
+}
+
+static inline uint8_t spi_busy( spi_req_t *req )
+{
+	return req->busy;
+}
+
+// wait for the transaction to complete, on its semaphore if it has one
+static inline void spi_wait( spi_req_t *req )
+{
+	while (req->busy)
+		if (req->sem) sem_wait(req->sem); else tsk_yield();
+}
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__SPI_H__
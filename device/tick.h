@@ -0,0 +1,105 @@
+#ifndef __TICK_H__
+#define __TICK_H__
+
+#include <stdint.h>
+#include <os.h>
+
+// division-free conversions between time units, system ticks and timer counts
+// TICK_MS / TICK_US / TIMER_US are for constant arguments and fold completely
+// at compile time; tick_ms / tick_us / tick_toMs / timer_us are for run-time
+// arguments: the ratio num/den is split at compile time into an integer part
+// and a 16-bit fraction (reciprocal constant), so a conversion costs a 16-bit
+// multiply by a constant (shifts for powers of two, nothing for 1) and, only
+// if the ratio is not an integer, one 16x16 bit multiply with a 32-bit result
+// all conversions round up (a delay is never shorter than requested); the run
+// time ones may exceed the exact result by one; arguments and results are
+// 16-bit and the exact result must stay below 65535
+//
+// usage:
+//   tsk_delay(TICK_MS(250));       // constant
+//   tsk_delay(tick_ms(timeout));   // variable, no division at run time
+//   TIM3->ARR = timer_us(period, 16) - 1;
+//
+// system time (cnt_t) is OS_TIMER_SIZE bits wide and wraps around; with the
+// 16-bit tick (osconfig.h) the counter is read with a single LDW and every
+// tick, delay and timeout computation is 16-bit, but time stamps must be
+// compared with the wrap-safe helpers below and intervals between compared
+// time stamps must stay below TICK_RANGE (32767 ticks, 32 s at 1 kHz)
+//   t = sys_time(); ... if (tick_timeout(t, TICK_MS(50))) ...
+// cycles of the tick increment and of a delay check for each width:
+// test/bench/tick.c (make -C test bench BENCH_DEFS="-DOS_TIMER_SIZE=32")
+
+/* -------------------------------------------------------------------------- */
+
+// ceil(x * num / den) of constants, 32-bit
+#define TICK_CONV( x, num, den ) ((uint32_t)(((uint32_t)(x) * (num) + (den) - 1) / (den)))
+
+#define TICK_MS( ms )           TICK_CONV(ms, OS_FREQUENCY, 1000UL)
+#define TICK_US( us )           TICK_CONV(us, OS_FREQUENCY, 1000000UL)
+// counts of a timer clocked at CPU_FREQUENCY / psc
+#define TIMER_US( us, psc )     TICK_CONV(us, (CPU_FREQUENCY) / (psc), 1000000UL)
+
+/* -------------------------------------------------------------------------- */
+
+// integer part and 16-bit fraction of num/den, computed by the compiler
+// in 32-bit integer arithmetic (no floating point constant folding needed):
+// the fraction is ceil(rem * 65536 / den), long division 8 bits at a time,
+// saturated at 0xFFFF; den must stay below 2^24
+#define TICK_INT( num, den )  ((uint16_t)((uint32_t)(num) / (den)))
+#define TICK_REM( num, den )  ((uint32_t)(num) % (den))
+#define _TICK_Q( r, den )     (((uint32_t)(r) << 8) / (den))
+#define _TICK_R( r, den )     (((uint32_t)(r) << 8) % (den))
+#define _TICK_F( r, den )     ((_TICK_Q(r, den) << 8) + _TICK_Q(_TICK_R(r, den), den) + (_TICK_R(_TICK_R(r, den), den) != 0))
+#define TICK_FRAC( num, den ) ((uint16_t)(_TICK_F(TICK_REM(num, den), den) > 0xFFFF ? 0xFFFF : _TICK_F(TICK_REM(num, den), den)))
+
+#define TICK_SCALE( x, num, den ) tick_scale(x, TICK_INT(num, den), TICK_FRAC(num, den))
+
+// x * (i + f / 65536), rounded up; (i) and (f) are constants after inlining
+static inline uint16_t tick_scale( uint16_t x, uint16_t i, uint16_t f )
+{
+	uint16_t y = 0;
+	if (i) y  = x * i;
+	if (f) y += (uint16_t)(((uint32_t)x * f + 0xFFFF) >> 16);
+	return y;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static inline uint16_t tick_ms  ( uint16_t ms ) { return TICK_SCALE(ms, OS_FREQUENCY, 1000UL); }
+static inline uint16_t tick_us  ( uint16_t us ) { return TICK_SCALE(us, OS_FREQUENCY, 1000000UL); }
+static inline uint16_t tick_toMs( uint16_t t  ) { return TICK_SCALE(t,  1000UL, OS_FREQUENCY); }
+
+// counts of a timer clocked at CPU_FREQUENCY / psc, (psc) must be a constant
+#define timer_us( us, psc )  TICK_SCALE(us, (CPU_FREQUENCY) / (psc), 1000000UL)
+
+/* -------------------------------------------------------------------------- */
+
+#if OS_TIMER_SIZE != 16 && OS_TIMER_SIZE != 32 && OS_TIMER_SIZE != 64
+// the STM8 has no native 24-bit type, a 24-bit counter would cost as much as a 32-bit one
+#error OS_TIMER_SIZE must be 16, 32 or 64
+#endif
+
+// longest interval the wrap-safe comparisons can tell apart
+#define TICK_RANGE   ((cnt_t)((cnt_t)-1 >> 1))
+
+// true if time (a) is before time (b)
+static inline uint8_t tick_before( cnt_t a, cnt_t b )
+{
+	return (cnt_t)(a - b) > TICK_RANGE;
+}
+
+// ticks elapsed since time (t)
+static inline cnt_t tick_since( cnt_t t )
+{
+	return (cnt_t)(sys_time() - t);
+}
+
+// true if more than (timeout) ticks elapsed since time (t)
+static inline uint8_t tick_timeout( cnt_t t, cnt_t timeout )
+{
+	return tick_since(t) > timeout;
+}
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__TICK_H__
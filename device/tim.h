@@ -0,0 +1,50 @@
+#ifndef __TIM_H__
+#define __TIM_H__
+
+#include <stm8s.h>
+
+// timer selection shared by the drivers
+// a driver takes its timer as a number (XXX_TIM: 1, 2 or 3, TIM4 is left to
+// the kernel tick), TIM_REG turns it into the register block, and the driver
+// claims it by including this header again with TIM_CLAIM defined; a second
+// claim of the same timer in a translation unit fails the build, so two
+// drivers sharing a timer are caught where their handlers are bound
+// the defaults are distinct where the hardware allows it: TIM1 (cpu.h; cap.h
+// and enc.h need it), TIM2 (bcm.h, mot.h), TIM3 (dds.h, tts.h); override the
+// number of one of the drivers in osconfig.h when they meet
+//
+// usage (in a driver):
+//   #ifndef XXX_TIM
+//   #define XXX_TIM          2
+//   #endif
+//   #define TIM_CLAIM XXX_TIM
+//   #include <tim.h>
+//   #define XXX_TIMER        TIM_REG(XXX_TIM)
+
+#define TIM_REG( n )     _TIM_REG(n)
+#define _TIM_REG( n )    TIM##n
+
+#endif//__TIM_H__
+
+// claim of timer TIM_CLAIM by the including driver, outside the include guard
+#ifdef TIM_CLAIM
+#if   TIM_CLAIM == 1
+#ifdef TIM1_CLAIMED
+#error TIM1 is used by two drivers, select another timer (XXX_TIM) in osconfig.h
+#endif
+#define TIM1_CLAIMED
+#elif TIM_CLAIM == 2
+#ifdef TIM2_CLAIMED
+#error TIM2 is used by two drivers, select another timer (XXX_TIM) in osconfig.h
+#endif
+#define TIM2_CLAIMED
+#elif TIM_CLAIM == 3
+#ifdef TIM3_CLAIMED
+#error TIM3 is used by two drivers, select another timer (XXX_TIM) in osconfig.h
+#endif
+#define TIM3_CLAIMED
+#else
+#error the timer of a driver must be 1, 2 or 3
+#endif
+#undef TIM_CLAIM
+#endif
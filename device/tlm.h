@@ -0,0 +1,173 @@
+#ifndef __TLM_H__
+#define __TLM_H__
+
+#include <os.h>
+#include <irq.h>
+#include <ring.h>
+#include <uart.h>
+#include <crc.h>
+
+// binary telemetry over UART2 (uart.h) in COBS-framed packets
+// a packet is seq(1) type(1) data(n) crc(2), the CRC-16 (crc.h) covering seq,
+// type and data, COBS-encoded so it contains no zero byte, and terminated by
+// a zero delimiter; samples are appended as raw bytes (no formatting) into a
+// packet buffer taken from a fixed pool, encoded in place when the packet is
+// closed and queued; tlm_poll moves queued packets to the UART transmit ring
+// as space allows and returns the buffers to the pool
+// every packet started takes a sequence number, also when the pool is empty
+// and the packet is dropped, so the receiver sees the gap
+// test/tlm.cpp is the host decoder (drop detection, CSV and binary export),
+// tested against this streamer over a pty
+//
+// usage:
+//   UART(16, 64);
+//   TLM();
+//   OS_TSK_DEF(log) { tlm_poll(); tsk_yield(); }
+//   ...
+//   if ((pkt = tlm_begin(1)) != 0) { TLM_PUT(pkt, adc); TLM_PUT(pkt, temp); tlm_end(pkt); }
+
+#ifndef TLM_SLOTS
+#define TLM_SLOTS        4  // packet buffers in the pool, power of two
+#endif
+#ifndef TLM_SIZE
+#define TLM_SIZE         48 // max data bytes of a packet, up to 249
+#endif
+
+#define TLM_FREE         0
+#define TLM_FILL         1
+#define TLM_READY        2
+
+/* -------------------------------------------------------------------------- */
+
+typedef struct __tlm_slot
+{
+	volatile uint8_t state;
+	uint8_t          len;                 // bytes used in buf
+	uint8_t          buf[TLM_SIZE + 6];   // code, seq, type, data, crc, delimiter
+}	tlm_slot_t;
+
+typedef struct __tlm
+{
+	tlm_slot_t slot[TLM_SLOTS];
+	uint8_t    seq;
+	uint8_t    cur;   // slot being sent + 1, 0 if none
+	uint8_t    pos;   // bytes of it sent
+	uint8_t    lost;  // packets dropped, pool empty (saturates)
+}	tlm_t;
+
+extern tlm_t tlm;
+extern ring_id tlm_q;
+
+RING_ASSERT( tlm__chk, (TLM_SIZE) <= 249 );
+
+// define the state of the streamer
+#define TLM()   RING( tlm_q, TLM_SLOTS ); \
+                tlm_t tlm
+
+#define TLM_PUT( pkt, var )  tlm_put(pkt, &(var), sizeof(var))
+
+/* -------------------------------------------------------------------------- */
+
+// start a packet of (type); returns 0 if the pool is empty
+static inline tlm_slot_t *tlm_begin( uint8_t type )
+{
+	tlm_slot_t *s = 0;
+	uint8_t i, seq;
+	irq_t cc = irq_lock();
+
+	seq = tlm.seq++;
+	for (i = 0; i < TLM_SLOTS; i++)
+	{
+		if (tlm.slot[i].state == TLM_FREE)
+		{
+			s = &tlm.slot[i];
+			s->state = TLM_FILL;
+			break;
+		}
+	}
+	if (s == 0 && tlm.lost < 0xFF) tlm.lost++;
+	irq_unlock(cc);
+
+	if (s)
+	{
+		s->buf[1] = seq;
+		s->buf[2] = type;
+		s->len    = 3;
+	}
+	return s;
+}
+
+// append (len) raw bytes; returns 0 if they do not fit
+static inline uint8_t tlm_put( tlm_slot_t *s, const void *data, uint8_t len )
+{
+	const uint8_t *p = (const uint8_t *)data;
+	uint8_t *d;
+
+	if (len > TLM_SIZE + 3 - s->len) return 0;
+	d = &s->buf[s->len];
+	s->len += len;
+	while (len--) *d++ = *p++;
+	return 1;
+}
+
+// add the CRC, encode in place (COBS) and queue the packet
+static inline void tlm_end( tlm_slot_t *s )
+{
+	uint8_t *b = s->buf;
+	uint8_t n = s->len;
+	uint16_t crc = crc16(CRC16_INIT, b + 1, n - 1);
+	uint8_t code = 0, i;
+	irq_t cc;
+
+	b[n++] = (uint8_t)(crc);
+	b[n++] = (uint8_t)(crc >> 8);
+
+	// the payload is b[1..n-1]; every zero byte takes the distance to the next
+	// zero (or to the end), b[0] the distance to the first one
+	for (i = 1; i < n; i++)
+	{
+		if (b[i] == 0)
+		{
+			b[code] = i - code;
+			code = i;
+		}
+	}
+	b[code] = n - code;
+	b[n++]  = 0;
+	s->len  = n;
+
+	cc = irq_lock();
+	s->state = TLM_READY;
+	ring_put(tlm_q, (uint8_t)(s - tlm.slot)); // never full: one entry per slot
+	irq_unlock(cc);
+}
+
+/* -------------------------------------------------------------------------- */
+
+// move queued packets to the UART; call repeatedly from a task
+static inline void tlm_poll( void )
+{
+	tlm_slot_t *s;
+	uint8_t i;
+
+	for (;;)
+	{
+		if (tlm.cur == 0)
+		{
+			if (!ring_get(tlm_q, &i)) return;
+			tlm.cur = i + 1;
+			tlm.pos = 0;
+		}
+
+		s = &tlm.slot[tlm.cur - 1];
+		tlm.pos += uart_write(s->buf + tlm.pos, s->len - tlm.pos);
+		if (tlm.pos < s->len) return; // transmit ring full
+
+		s->state = TLM_FREE;
+		tlm.cur  = 0;
+	}
+}
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__TLM_H__
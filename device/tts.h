@@ -0,0 +1,158 @@
+#ifndef __TTS_H__
+#define __TTS_H__
+
+#include <stm8s.h>
+#include <osconfig.h>
+#include <tim.h>
+
+// time-triggered static scheduler
+// a constant table of (offset, period, function) entries is dispatched from
+// the update interrupt of a dedicated hardware timer, independently of the
+// cooperative IntrOS tasks; the dispatch latency of every entry is measured
+// against the timer counter and recorded as min / max per entry
+// entries run in interrupt context: keep them short and never block
+//
+// usage:
+//   static void loop( void ) { ... }
+//   static const tts_entry_t table[] = { { 0, 1, loop }, { 3, 10, log } };
+//   TTS(tts, table);
+//   INTERRUPT_HANDLER(TIM3_UPD_OVF_BRK_IRQHandler, 15) { tts_handler(tts); }
+//   ...
+//   tts_start(tts);
+
+#ifndef TTS_TIM
+#define TTS_TIM          3    // timebase timer (2 or 3)
+#endif
+
+#define TIM_CLAIM TTS_TIM
+#include <tim.h>
+#define TTS_TIMER        TIM_REG(TTS_TIM)
+#ifndef TTS_FREQUENCY
+#define TTS_FREQUENCY    OS_FREQUENCY   // dispatch frequency (Hz)
+#endif
+
+// timer counts at CPU_FREQUENCY / 16, i.e. 1 MHz on the discovery board
+#define TTS_PSC          4
+#define TTS_CLOCK      ((CPU_FREQUENCY) >> TTS_PSC)
+#define TTS_ARR        ((TTS_CLOCK) / (TTS_FREQUENCY) - 1)
+
+#if TTS_ARR > 0xFFFF || TTS_ARR < 1
+#error Incorrect TTS_FREQUENCY!
+#endif
+
+/* -------------------------------------------------------------------------- */
+
+typedef void tts_fun_t( void );
+
+typedef struct __tts_entry
+{
+	uint16_t   offset;  // first dispatch, in ticks after tts_start
+	uint16_t   period;  // in ticks, must be non-zero
+	tts_fun_t *fun;
+}	tts_entry_t;
+
+typedef struct __tts_stat
+{
+	uint16_t   wait;    // ticks left to the next dispatch
+	uint16_t   min;     // min latency from the timer update event (timer counts)
+	uint16_t   max;     // max latency from the timer update event (timer counts)
+	uint16_t   runs;    // number of dispatches (wraps)
+}	tts_stat_t;
+
+typedef struct __tts
+{
+	const tts_entry_t *tab;
+	tts_stat_t *stat;
+	uint8_t     cnt;
+	uint8_t     overrun; // ticks in which the dispatch did not fit in the period (saturates)
+}	tts_t, *tts_id;
+
+/* -------------------------------------------------------------------------- */
+
+#define TTS_COUNT( table ) (sizeof(table) / sizeof(*(table)))
+
+#define _TTS_INIT( table, stat ) { table, stat, TTS_COUNT(table), 0 }
+
+// define a scheduler (tts) dispatching the constant (table)
+#define             TTS( tts, table )                                       \
+                    tts_stat_t tts##__stat[TTS_COUNT(table)];               \
+                    tts_t tts##__tts = _TTS_INIT( table, tts##__stat );     \
+                    tts_id tts = & tts##__tts
+
+#define      static_TTS( tts, table )                                       \
+             static tts_stat_t tts##__stat[TTS_COUNT(table)];               \
+             static tts_t tts##__tts = _TTS_INIT( table, tts##__stat );     \
+             static tts_id tts = & tts##__tts
+
+/* -------------------------------------------------------------------------- */
+
+static inline uint16_t tts_counter( void )
+{
+	uint8_t h = TTS_TIMER->CNTRH; // reading CNTRH latches CNTRL
+	return ((uint16_t)h << 8) | TTS_TIMER->CNTRL;
+}
+
+static inline void tts_start( tts_id tts )
+{
+	uint8_t i;
+	for (i = 0; i < tts->cnt; i++)
+	{
+		tts->stat[i].wait = tts->tab[i].offset;
+		tts->stat[i].min  = 0xFFFF;
+		tts->stat[i].max  = 0;
+		tts->stat[i].runs = 0;
+	}
+	tts->overrun = 0;
+
+	TTS_TIMER->PSCR  = TTS_PSC;
+	TTS_TIMER->ARRH  = (uint8_t)(TTS_ARR >> 8);
+	TTS_TIMER->ARRL  = (uint8_t)(TTS_ARR);
+	TTS_TIMER->EGR   = TIM3_EGR_UG;
+	TTS_TIMER->SR1   = (uint8_t)~TIM3_SR1_UIF;
+	TTS_TIMER->IER  |= TIM3_IER_UIE;
+	TTS_TIMER->CR1  |= TIM3_CR1_CEN;
+}
+
+static inline void tts_stop( tts_id tts )
+{
+	(void) tts;
+	TTS_TIMER->CR1 &= (uint8_t)~TIM3_CR1_CEN;
+	TTS_TIMER->IER &= (uint8_t)~TIM3_IER_UIE;
+}
+
+// call from the update interrupt handler of TTS_TIM
+static inline void tts_handler( tts_id tts )
+{
+	const tts_entry_t *e = tts->tab;
+	tts_stat_t *s = tts->stat;
+	uint8_t i;
+
+	TTS_TIMER->SR1 = (uint8_t)~TIM3_SR1_UIF;
+
+	for (i = tts->cnt; i; i--, e++, s++)
+	{
+		if (s->wait) { s->wait--; continue; }
+		s->wait = e->period - 1;
+		{
+			uint16_t lat = tts_counter();
+			if (lat < s->min) s->min = lat;
+			if (lat > s->max) s->max = lat;
+		}
+		s->runs++;
+		e->fun();
+	}
+
+	if ((TTS_TIMER->SR1 & TIM3_SR1_UIF) && tts->overrun < 0xFF)
+		tts->overrun++;
+}
+
+// peak-to-peak dispatch jitter of entry (i), in timer counts
+static inline uint16_t tts_jitter( tts_id tts, uint8_t i )
+{
+	tts_stat_t *s = &tts->stat[i];
+	return s->runs ? s->max - s->min : 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__TTS_H__
@@ -0,0 +1,96 @@
+#ifndef __UART_H__
+#define __UART_H__
+
+#include <stm8s.h>
+#include <osconfig.h>
+#include <ring.h>
+
+// uart: UART2 (TX: PD5, RX: PD6), interrupt driven through ring buffers
+// the application defines the buffers once and binds both handlers:
+//   UART(32, 64);
+//   INTERRUPT_HANDLER(UART2_TX_IRQHandler, 20) { uart_txHandler(); }
+//   INTERRUPT_HANDLER(UART2_RX_IRQHandler, 21) { uart_rxHandler(); }
+
+#ifndef UART_BAUD
+#define UART_BAUD        115200
+#endif
+
+#define UART_DIV ((CPU_FREQUENCY + (UART_BAUD) / 2) / (UART_BAUD))
+
+// define receive and transmit buffers of (rxsize) and (txsize) bytes
+#define UART( rxsize, txsize )                 \
+        RING( uart_rx, rxsize );               \
+        RING( uart_tx, txsize );               \
+        volatile uint8_t uart_overrun = 0;     \
+        volatile uint8_t uart_dropped = 0
+
+extern ring_id uart_rx;
+extern ring_id uart_tx;
+extern volatile uint8_t uart_overrun; // hardware overruns, bytes lost before DR was read (saturates)
+extern volatile uint8_t uart_dropped; // received bytes dropped, receive buffer full (saturates)
+
+/* -------------------------------------------------------------------------- */
+
+static inline void uart_init( void )
+{
+	UART2->BRR2 = (uint8_t)(((UART_DIV >> 8) & 0xF0) | (UART_DIV & 0x0F)); // BRR2 first
+	UART2->BRR1 = (uint8_t)(UART_DIV >> 4);
+	UART2->CR2  = UART2_CR2_TEN | UART2_CR2_REN | UART2_CR2_RIEN;
+}
+
+static inline void uart_rxHandler( void )
+{
+	uint8_t sr = UART2->SR;
+	uint8_t c  = UART2->DR; // reading SR then DR also clears the error flags
+	// on overrun the byte in DR is still valid, only the following one was lost
+	if ((sr & UART2_SR_OR) && uart_overrun < 0xFF)
+		uart_overrun++;
+	if (!ring_put(uart_rx, c) && uart_dropped < 0xFF)
+		uart_dropped++;
+}
+
+static inline void uart_txHandler( void )
+{
+	uint8_t c;
+	if (ring_get(uart_tx, &c))
+		UART2->DR = c;
+	else
+		UART2->CR2 &= (uint8_t)~UART2_CR2_TIEN;
+}
+
+/* -------------------------------------------------------------------------- */
+
+// non-blocking; returns number of bytes queued
+static inline uint8_t uart_write( const void *buf, uint8_t len )
+{
+	len = ring_write(uart_tx, (const uint8_t *)buf, len);
+	UART2->CR2 |= UART2_CR2_TIEN;
+	return len;
+}
+
+// blocking; busy-waits for room in the transmit buffer
+static inline void uart_putc( uint8_t c )
+{
+	while (!ring_put(uart_tx, c));
+	UART2->CR2 |= UART2_CR2_TIEN;
+}
+
+static inline void uart_puts( const char *s )
+{
+	while (*s) uart_putc((uint8_t)*s++);
+}
+
+// non-blocking; returns number of bytes read
+static inline uint8_t uart_read( void *buf, uint8_t len )
+{
+	return ring_read(uart_rx, (uint8_t *)buf, len);
+}
+
+static inline uint8_t uart_getc( uint8_t *c )
+{
+	return ring_get(uart_rx, c);
+}
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__UART_H__
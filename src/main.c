@@ -1,7 +1,9 @@
 #include <led.h>
 #include <os.h>
+#include <prd.h>
 
 OS_SEM(sem, 0, semBinary);
+PRD(prd, SEC);
 
 OS_TSK_DEF(sla)
 {
@@ -11,7 +13,7 @@ OS_TSK_DEF(sla)
 
 OS_TSK_DEF(mas)
 {
-	tsk_delay(SEC);
+	prd_wait(prd);
 	sem_give(sem);
 }
 
@@ -4,6 +4,8 @@
 #define CPU_FREQUENCY  16000000
 #define OS_FREQUENCY       1000
 #define OS_STACK_SIZE       128
-#define OS_TIMER_SIZE        16
+#ifndef OS_TIMER_SIZE
+#define OS_TIMER_SIZE        16 // 16, 32 or 64 bits, see tick.h
+#endif
 
 #endif//__OSCONFIG_H
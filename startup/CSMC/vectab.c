@@ -105,11 +105,11 @@ void (* const @vector _vectab[32])() =
 #endif
 /* 19 */  I2C_IRQHandler,
 #if   defined(STM8S105) || defined(STM8S005) || defined(STM8AF626x)
-/* 20 */  UART2_RX_IRQHandler,
-/* 21 */  UART2_TX_IRQHandler,
+/* 20 */  UART2_TX_IRQHandler,
+/* 21 */  UART2_RX_IRQHandler,
 #elif defined(STM8S207) || defined(STM8S007) || defined(STM8S208) || defined(STM8AF52Ax) || defined(STM8AF62Ax)
-/* 20 */  UART3_RX_IRQHandler,
-/* 21 */  UART3_TX_IRQHandler,
+/* 20 */  UART3_TX_IRQHandler,
+/* 21 */  UART3_RX_IRQHandler,
 #else
 /* 20 */  0,
 /* 21 */  0,
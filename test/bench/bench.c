@@ -0,0 +1,73 @@
+#include <bench.h>
+#include <os.h>
+
+// runs every benchmark once and stops the simulator (break)
+
+#define BENCH_DIV ((16000000UL + 115200 / 2) / 115200)
+
+uint16_t bench_zero;
+volatile cnt_t bench_time;
+
+uint16_t bench_now( void )
+{
+	uint8_t h = TIM2->CNTRH; // reading CNTRH latches CNTRL
+	return ((uint16_t)h << 8) | TIM2->CNTRL;
+}
+
+static void bench_putc( char c )
+{
+	while ((UART2->SR & UART2_SR_TXE) == 0);
+	UART2->DR = (uint8_t)c;
+}
+
+static void bench_puts( const char *s )
+{
+	while (*s) bench_putc(*s++);
+}
+
+void bench_report( const char *name, uint16_t cycles )
+{
+	char buf[6];
+	char *p = buf + sizeof(buf);
+	*--p = 0;
+	do { *--p = (char)('0' + cycles % 10); cycles /= 10; } while (cycles);
+	bench_puts(name);
+	bench_puts(": ");
+	bench_puts(p);
+	bench_puts("\r\n");
+}
+
+void bench_check( const char *name, uint8_t ok )
+{
+	bench_puts(name);
+	bench_puts(ok ? ": ok\r\n" : ": FAILED\r\n");
+}
+
+void main( void )
+{
+	uint16_t t;
+
+	CLK->CKDIVR = 0;         // fCPU = fMASTER = 16 MHz
+	UART2->BRR2 = (uint8_t)(((BENCH_DIV >> 8) & 0xF0) | (BENCH_DIV & 0x0F));
+	UART2->BRR1 = (uint8_t)(BENCH_DIV >> 4);
+	UART2->CR2  = UART2_CR2_TEN;
+	TIM2->PSCR  = 0;
+	TIM2->ARRH  = 0xFF;
+	TIM2->ARRL  = 0xFF;
+	TIM2->EGR   = TIM2_EGR_UG;
+	TIM2->CR1   = TIM2_CR1_CEN;
+
+	t = bench_now();
+	bench_zero = bench_now() - t;
+
+	bench_ring();
+	bench_pid();
+	bench_crc();
+	bench_dsp();
+	bench_dds();
+	bench_tick();
+
+	while ((UART2->SR & UART2_SR_TC) == 0);
+	__asm__("break");
+	for (;;);
+}
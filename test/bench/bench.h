@@ -0,0 +1,35 @@
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <stm8s.h>
+
+// cycle counting for the sstm8 benchmarks: TIM2 runs at fCPU (prescaler 1),
+// BENCH times one statement and prints "name: cycles" on UART2; the cost of
+// reading the counter is measured at start and subtracted
+// a statement must take less than 65536 cycles; bench_check prints
+// "name: ok" or "name: FAILED"
+//
+// usage:
+//   void bench_xxx( void ) { BENCH("xxx_put", xxx_put(&x, 1)); }
+
+extern uint16_t bench_zero;
+
+uint16_t bench_now( void );
+void     bench_report( const char *name, uint16_t cycles );
+void     bench_check( const char *name, uint8_t ok );
+
+#define BENCH( name, stmt ) \
+        do { uint16_t bench__t = bench_now(); stmt; bench_report(name, (uint16_t)(bench_now() - bench__t - bench_zero)); } while (0)
+
+/* -------------------------------------------------------------------------- */
+
+void bench_ring( void );
+void bench_pid( void );
+void bench_crc( void );
+void bench_dsp( void );
+void bench_dds( void );
+void bench_tick( void );
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__BENCH_H__
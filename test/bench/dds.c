@@ -0,0 +1,18 @@
+#include <bench.h>
+#include <dds.h>
+#include <wave.h>
+
+// dds_handler (dds.h), the body of the update interrupt of DDS_TIM; the
+// interrupt entry and IRET are not included; the timer is not started, the
+// handler only writes its registers
+
+DDS();
+
+void bench_dds( void )
+{
+	dds.wave  = wave_sine;
+	dds.inc   = DDS_INCREMENT(440);
+	dds.phase = 0xFF00;
+	BENCH("dds_handler", dds_handler());
+	BENCH("dds_handler", dds_handler()); // phase wrapped
+}
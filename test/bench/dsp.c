@@ -0,0 +1,25 @@
+#include <bench.h>
+#include <dsp.h>
+
+// the dsp.h kernels, one sample each; med_put on its worst case, the oldest
+// sample at the top of the sorted window and the new one below all the rest
+
+static_MAV( mav, 32 );
+static_MED( med, 15 );
+
+static lpf_t    lpf = _LPF_INIT( 4 );
+static biquad_t bq  = _BIQUAD_INIT( 1, 2, 1, -31000, 14700 );
+
+void bench_dsp( void )
+{
+	uint8_t i;
+
+	BENCH("mav_put",    mav_put(mav, 12345));
+	BENCH("lpf_put",    lpf_put(&lpf, -32768));
+	BENCH("lpf_put",    lpf_put(&lpf, 32767));
+	BENCH("biquad_put", biquad_put(&bq, 32767));
+
+	med_put(med, 32767);                       // the oldest sample is the maximum,
+	for (i = 0; i < 14; i++) med_put(med, 0);  // found last in the sorted window,
+	BENCH("med_put_15", med_put(med, -32768)); // and the new one goes to the bottom
+}
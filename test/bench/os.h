@@ -0,0 +1,25 @@
+#ifndef __OS_H
+#define __OS_H
+
+#include <stdint.h>
+#include <osconfig.h>
+
+// bench stand-in for the IntrOS api used by the drivers (the kernel is not
+// part of the benchmark): the system time is bench_time, advanced by hand
+
+#if   OS_TIMER_SIZE == 16
+typedef uint16_t cnt_t;
+#elif OS_TIMER_SIZE == 32
+typedef uint32_t cnt_t;
+#else
+typedef uint64_t cnt_t;
+#endif
+
+extern volatile cnt_t bench_time;
+
+static inline cnt_t sys_time( void )
+{
+	return bench_time;
+}
+
+#endif//__OS_H
@@ -0,0 +1,16 @@
+#include <bench.h>
+#include <pid.h>
+
+// pid_update (pid.h) on its paths: linear output, and the worst case, a
+// saturated output with a nonzero derivative and the integral clamped
+
+static_PID(pid, Q15(0.5), Q15(0.01), Q15(0.1), 2, -32768, 32767, 3);
+
+void bench_pid( void )
+{
+	pid_reset(&pid, 0);
+	BENCH("pid_update",     pid_update(&pid, 100, 90));
+	pid_reset(&pid, 0);
+	BENCH("pid_update_sat", pid_update(&pid, 32767, -32768));
+	BENCH("pid_update_sat", pid_update(&pid, 32767, -32000));
+}
@@ -0,0 +1,55 @@
+#include <bench.h>
+#include <irq.h>
+#include <ring.h>
+
+// lock-free ring (ring.h) against a buffer guarded by disabling interrupts,
+// the usual form with a shared element count
+
+typedef struct
+{
+	uint8_t head, tail, count;
+	uint8_t data[64];
+}	lck_ring_t;
+
+static void lck_put( lck_ring_t *r, uint8_t c )
+{
+	irq_t cc = irq_lock();
+	if (r->count < sizeof(r->data))
+	{
+		r->data[r->head] = c;
+		r->head = (r->head + 1) % sizeof(r->data);
+		r->count++;
+	}
+	irq_unlock(cc);
+}
+
+static uint8_t lck_get( lck_ring_t *r, uint8_t *c )
+{
+	uint8_t ok = 0;
+	irq_t cc = irq_lock();
+	if (r->count)
+	{
+		*c = r->data[r->tail];
+		r->tail = (r->tail + 1) % sizeof(r->data);
+		r->count--;
+		ok = 1;
+	}
+	irq_unlock(cc);
+	return ok;
+}
+
+static_RING(rng, 64);
+static lck_ring_t lck;
+static uint8_t buf[32];
+
+void bench_ring( void )
+{
+	uint8_t c;
+
+	BENCH("ring_put",   ring_put(rng, 1));
+	BENCH("ring_get",   ring_get(rng, &c));
+	BENCH("lck_put",    lck_put(&lck, 1));
+	BENCH("lck_get",    lck_get(&lck, &c));
+	BENCH("ring_write", ring_write(rng, buf, sizeof(buf)));
+	BENCH("ring_read",  ring_read(rng, buf, sizeof(buf)));
+}
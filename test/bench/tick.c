@@ -0,0 +1,21 @@
+#include <bench.h>
+#include <tick.h>
+
+// the parts of the kernel tick and of a delay that scale with OS_TIMER_SIZE:
+// the increment of the system time in the tick interrupt, its read by a task
+// and the wrap-safe expiry check of a delay, once per tick for every waiting
+// task; the kernel itself is not part of the benchmark (os.h of bench/),
+// compare the widths with BENCH_DEFS="-DOS_TIMER_SIZE=32" and 64
+
+void bench_tick( void )
+{
+	cnt_t   t = 0;
+	uint8_t e = 0;
+
+	bench_time = (cnt_t)-2;
+	BENCH("tick_isr",     bench_time++);
+	BENCH("tick_isr",     bench_time++); // carry through every byte
+	BENCH("sys_time",     t = sys_time());
+	BENCH("tick_timeout", e = tick_timeout(t, TICK_MS(250)));
+	bench_check("tick_timeout", e == 0);
+}
@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <crc.h>
+
+// CRC kernels (crc.h): the check values (the CRC of "123456789"), and random
+// buffers in random splits against bit by bit references; the makefile builds
+// this test with crc.c once per method (crc-0/1/2.test: CRC_METHOD = 0..2)
+
+#define ROUNDS           2000
+
+static int errors;
+
+static void expect( int ok, const char *what )
+{
+	printf("crc: %-40s %s\n", what, ok ? "ok" : "FAILED");
+	if (!ok) errors++;
+}
+
+static uint8_t ref8( uint8_t crc, const uint8_t *p, int len )
+{
+	int i;
+	while (len--) for (crc ^= *p++, i = 0; i < 8; i++) crc = (uint8_t)(crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1);
+	return crc;
+}
+
+static uint16_t ref16( uint16_t crc, const uint8_t *p, int len )
+{
+	int i;
+	while (len--) for (crc ^= (uint16_t)(*p++ << 8), i = 0; i < 8; i++) crc = (uint16_t)(crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1);
+	return crc;
+}
+
+static uint32_t ref32( uint32_t crc, const uint8_t *p, int len )
+{
+	int i;
+	while (len--) for (crc ^= *p++, i = 0; i < 8; i++) crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320UL : crc >> 1;
+	return crc;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void test_check( void )
+{
+	static const char s[] = "123456789";
+	char what[48];
+	uint32_t crc;
+
+	snprintf(what, sizeof(what), "CRC-8 check 0xF4, method %d", CRC8_METHOD);
+	expect(crc8(CRC8_INIT, s, 9) == 0xF4, what);
+	snprintf(what, sizeof(what), "CRC-16 check 0x29B1, method %d", CRC16_METHOD);
+	expect(crc16(CRC16_INIT, s, 9) == 0x29B1, what);
+	snprintf(what, sizeof(what), "CRC-32 check 0xCBF43926, method %d", CRC32_METHOD);
+	crc = CRC32_FINAL(crc32(CRC32_INIT, s, 9));
+	expect(crc == 0xCBF43926UL, what);
+}
+
+static void test_random( void )
+{
+	static uint8_t buf[300];
+	int ok8 = 1, ok16 = 1, ok32 = 1;
+	int r, i, len, cut;
+
+	for (r = 0; r < ROUNDS; r++)
+	{
+		len = rand() % (int)sizeof(buf);
+		cut = len ? rand() % (len + 1) : 0;
+		for (i = 0; i < len; i++) buf[i] = (uint8_t)rand();
+		if (crc8(crc8((uint8_t)r, buf, (uint16_t)cut), buf + cut, (uint16_t)(len - cut)) != ref8((uint8_t)r, buf, len)) ok8 = 0;
+		if (crc16(crc16((uint16_t)r, buf, (uint16_t)cut), buf + cut, (uint16_t)(len - cut)) != ref16((uint16_t)r, buf, len)) ok16 = 0;
+		if (crc32(crc32((uint32_t)r * 0x9E3779B9UL, buf, (uint16_t)cut), buf + cut, (uint16_t)(len - cut)) != ref32((uint32_t)r * 0x9E3779B9UL, buf, len)) ok32 = 0;
+	}
+	expect(ok8,  "CRC-8 random buffers and splits");
+	expect(ok16, "CRC-16 random buffers and splits");
+	expect(ok32, "CRC-32 random buffers and splits");
+}
+
+/* -------------------------------------------------------------------------- */
+
+int main( void )
+{
+	srand(1);
+	test_check();
+	test_random();
+	return errors != 0;
+}
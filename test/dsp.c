@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <dsp.h>
+
+// fixed-point kernels (dsp.h) against double precision references, on full
+// scale steps, random walks and noise; built with -fsanitize=undefined, so a
+// signed overflow or a shift of a negative value fails the test too
+
+#define SAMPLES          20000
+
+static int errors;
+
+static void expect( int ok, const char *what, double err )
+{
+	printf("dsp: %-40s max error %8.4f LSB %s\n", what, err, ok ? "ok" : "FAILED");
+	if (!ok) errors++;
+}
+
+// test signal (n) of kind (sig): full-scale square wave, random walk, noise
+static int16_t input( int sig, int n )
+{
+	static int32_t walk;
+	switch (sig)
+	{
+	case 0:  return (n / 97) & 1 ? 32767 : -32768;
+	case 1:  walk += rand() % 2049 - 1024; walk = walk > 32767 ? 32767 : walk < -32768 ? -32768 : walk; return (int16_t)walk;
+	default: return (int16_t)(rand() % 65536 - 32768);
+	}
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void test_lpf( void )
+{
+	double max = 0;
+	uint8_t k;
+	int sig, n;
+
+	for (k = 1; k < 16; k++)
+	{
+		for (sig = 0; sig < 3; sig++)
+		{
+			lpf_t f = _LPF_INIT( k );
+			double y = 0;
+			for (n = 0; n < SAMPLES; n++)
+			{
+				int16_t x = input(sig, n);
+				double e;
+				y += (x - y) / (1 << k);
+				e = fabs(lpf_put(&f, x) - y);
+				if (e > max) max = e;
+			}
+		}
+	}
+	// the state is truncated by less than 2^-16 per sample, 2^k samples
+	// deep (half an LSB at k = 15), then the output is rounded
+	expect(max <= 1.0, "lpf_put, k = 1..15", max);
+}
+
+static void test_mul( void )
+{
+	double max = 0;
+	int n;
+
+	for (n = 0; n < SAMPLES * 10; n++)
+	{
+		q15_t a = (q15_t)(rand() % 65536 - 32768);
+		q15_t b = (q15_t)(rand() % 65536 - 32768);
+		double r = a * (double)b / 32768, e;
+		if (n == 0) a = b = -32768; // -1 * -1 saturates
+		if (n == 0) r = 32767;
+		e = fabs(q15_mul(a, b) - r);
+		if (e > max) max = e;
+	}
+	expect(max <= 0.5, "q15_mul", max);
+}
+
+static_MAV( mav, 32 );
+
+static void test_mav( void )
+{
+	double buf[32] = { 0 }, max = 0;
+	int sig, n;
+
+	for (sig = 0; sig < 3; sig++)
+	{
+		for (n = 0; n < SAMPLES; n++)
+		{
+			int16_t x = input(sig, n);
+			double s = 0, e;
+			int i;
+			buf[n & 31] = x;
+			for (i = 0; i < 32; i++) s += buf[i];
+			e = fabs(mav_put(mav, x) - s / 32);
+			if (e > max) max = e;
+		}
+	}
+	expect(max < 1.0, "mav_put, 32 samples", max);
+}
+
+static void test_biquad( void )
+{
+	// low-pass, fc = fs / 20, Q = 0.707 (bilinear transform)
+	double w = 2 * M_PI / 20, al = sin(w) / (2 * 0.7071), a0 = 1 + al;
+	double b0 = (1 - cos(w)) / 2 / a0, b1 = (1 - cos(w)) / a0, b2 = b0;
+	double a1 = -2 * cos(w) / a0, a2 = (1 - al) / a0;
+	biquad_t f = _BIQUAD_INIT( Q14(b0), Q14(b1), Q14(b2), Q14(a1), Q14(a2) );
+	double x1 = 0, x2 = 0, y1 = 0, y2 = 0, max = 0;
+	int n;
+
+	for (n = 0; n < SAMPLES; n++)
+	{
+		int16_t x = (int16_t)(input(1, n) / 2); // half scale, no overshoot past the range
+		double y = b0 * x + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2, e;
+		x2 = x1; x1 = x; y2 = y1; y1 = y;
+		e = fabs(biquad_put(&f, x) - y);
+		if (e > max) max = e;
+	}
+	// Q14 coefficients are off by up to 2^-15 each, the feedback amplifies it
+	expect(max <= 16.0, "biquad_put, Q14 low-pass", max);
+}
+
+static void test_biquad_range( void )
+{
+	// |b0| + |b1| + |b2| + |a1| + |a2| just below 4, extreme coefficients and
+	// full-scale noise: the sanitizer fails the test if the accumulator overflows
+	biquad_t f = _BIQUAD_INIT( Q14(0.25), Q14(0.25), Q14(0.25) - 1, -32768, Q14(1.25) );
+	int n;
+
+	for (n = 0; n < SAMPLES; n++)
+		(void) biquad_put(&f, input(n & 1 ? 0 : 2, n));
+	expect(1, "biquad_put, full scale, sum |c| < 4", 0);
+}
+
+static int cmp( const void *a, const void *b )
+{
+	return *(const int16_t *)a - *(const int16_t *)b;
+}
+
+static_MED( med3, 3 );
+static_MED( med15, 15 );
+
+// against sorting a copy of the window, with runs of repeated values
+static void test_med( med_id f, int size, const char *what )
+{
+	int16_t win[15] = { 0 }, tmp[15];
+	double max = 0;
+	int sig, n, i = 0;
+
+	for (sig = 0; sig < 3; sig++)
+	{
+		for (n = 0; n < SAMPLES; n++)
+		{
+			int16_t x = input(sig, n);
+			double e;
+			if (sig == 2 && (n & 4)) x &= 0x0F00;
+			win[i] = x;
+			if (++i == size) i = 0;
+			memcpy(tmp, win, sizeof(tmp));
+			qsort(tmp, size, sizeof(*tmp), cmp);
+			e = abs(med_put(f, x) - tmp[size / 2]);
+			if (e > max) max = e;
+		}
+	}
+	expect(max == 0, what, max);
+}
+
+/* -------------------------------------------------------------------------- */
+
+int main( void )
+{
+	srand(1);
+	test_lpf();
+	test_mul();
+	test_mav();
+	test_biquad();
+	test_biquad_range();
+	test_med(med3, 3, "med_put, 3 samples");
+	test_med(med15, 15, "med_put, 15 samples");
+	return errors != 0;
+}
@@ -0,0 +1,357 @@
+// firmware update engine (fwu.h) against the host sender over a pty
+// the engine runs in a thread on the slave side of a pty, with the record
+// store on the EEPROM fake and the program memory in flash_mem; the sender
+// (fwu_sender) on the master side transfers images through the clean, NACK,
+// broken frame, flash failure and reboot / resume paths
+// with arguments, the sender transfers an image to a target (or to sstm8)
+// on a serial port or pty instead:
+//   fwu.test /dev/ttyUSB0 image.bin id
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define FWU_START ((uintptr_t)flash_mem)
+#include <fwu.h>
+
+EEP();
+REC();
+UART(0, 0);
+FWU();
+
+using namespace std::chrono;
+
+/* -------------------------------------------------------------------------- */
+
+// host side of the update protocol (see fwu.h)
+struct fwu_sender
+{
+	// called with every block frame before it is sent: may corrupt or cut it,
+	// or return false to abort the transfer (the host goes away)
+	std::function<bool(uint16_t idx, std::vector<uint8_t> &frame)> fault;
+
+	int      fd;
+	int      nacks    = 0; // 'N' replies
+	int      recovers = 0; // re-queries after a failure or a lost reply
+	uint16_t resumed  = 0; // block the transfer started from
+
+	explicit fwu_sender( int fd ) : fd(fd) {}
+
+	bool send( const std::vector<uint8_t> &image, uint16_t id )
+	{
+		uint16_t cnt = (uint16_t)((image.size() + FLASH_BLOCK - 1) / FLASH_BLOCK);
+		std::vector<uint8_t> img(image);
+		img.resize((size_t)cnt * FLASH_BLOCK, 0); // erased flash reads 0x00
+		uint16_t crc = crc16(CRC16_INIT, img.data(), (uint16_t)img.size());
+		uint16_t base, next;
+		uint8_t  window;
+
+		if (!query(id, base, window)) return false;
+		resumed = next = base;
+
+		for (int tries = 0; tries < 1000; tries++)
+		{
+			uint16_t end = (uint16_t)std::min<int>(base + window, cnt);
+			uint8_t  r[3];
+
+			for (uint16_t i = next; i < end; i++)
+				if (!block(img, i)) return false;
+
+			if (end - base < window) // last window, programmed by 'E'
+			{
+				uint8_t msg[5] = { 'E', (uint8_t)cnt, (uint8_t)(cnt >> 8), (uint8_t)crc, (uint8_t)(crc >> 8) };
+				put(msg, sizeof(msg));
+				if (reply(r) == 'K') return true;
+				if (!recover(id, base, window)) return false;
+				next = base;
+				continue;
+			}
+
+			switch (reply(r))
+			{
+			case 'A':
+				base = next = (uint16_t)(r[1] | r[2] << 8);
+				break;
+			case 'N': // resend from the block requested, within the window
+				nacks++;
+				pause();
+				next = (uint16_t)(r[1] | r[2] << 8);
+				if (next < base || next >= base + window) base = next;
+				break;
+			default: // reply lost, the engine rebooted or the window was cut
+				if (!recover(id, base, window)) return false;
+				next = base;
+				break;
+			}
+		}
+
+		return false;
+	}
+
+private:
+
+	void put( const void *buf, size_t len )
+	{
+		const uint8_t *p = (const uint8_t *)buf;
+		while (len)
+		{
+			ssize_t n = write(fd, p, len);
+			if (n > 0) { p += n; len -= (size_t)n; }
+		}
+	}
+
+	// next byte within (ms), or -1
+	int get( int ms )
+	{
+		struct pollfd pfd = { fd, POLLIN, 0 };
+		uint8_t c;
+		if (poll(&pfd, 1, ms) <= 0 || read(fd, &c, 1) != 1) return -1;
+		return c;
+	}
+
+	// type of the next reply and its value, or -1 after a timeout
+	int reply( uint8_t r[3] )
+	{
+		int c = get(500);
+		if (c == 'A' || c == 'N' || c == 'R')
+		{
+			for (int i = 1; i < 3; i++)
+			{
+				int v = get(100);
+				if (v < 0) return -1;
+				r[i] = (uint8_t)v;
+			}
+		}
+		return c;
+	}
+
+	// wait for the parser to resync and drop the replies still coming
+	void pause( void )
+	{
+		std::this_thread::sleep_for(milliseconds(2 * 1000 * FWU_TIMEOUT / SEC));
+		while (get(0) >= 0);
+	}
+
+	bool query( uint16_t id, uint16_t &next, uint8_t &window )
+	{
+		uint8_t msg[3] = { 'Q', (uint8_t)id, (uint8_t)(id >> 8) };
+		uint8_t r[3];
+		put(msg, sizeof(msg));
+		if (reply(r) != 'R') return false;
+		next   = (uint16_t)(r[1] | r[2] << 8);
+		int w  = get(100);
+		window = (uint8_t)(w > 0 ? w : 1);
+		return w > 0;
+	}
+
+	bool recover( uint16_t id, uint16_t &next, uint8_t &window )
+	{
+		for (int i = 0; i < 10; i++)
+		{
+			recovers++;
+			pause();
+			if (query(id, next, window)) return true;
+		}
+		return false;
+	}
+
+	bool block( const std::vector<uint8_t> &img, uint16_t idx )
+	{
+		std::vector<uint8_t> f;
+		uint8_t hdr[2] = { (uint8_t)idx, (uint8_t)(idx >> 8) };
+		uint16_t crc = crc16(crc16(CRC16_INIT, hdr, 2), &img[(size_t)idx * FLASH_BLOCK], FLASH_BLOCK);
+
+		f.push_back('D');
+		f.push_back(hdr[0]);
+		f.push_back(hdr[1]);
+		f.insert(f.end(), img.begin() + (size_t)idx * FLASH_BLOCK, img.begin() + (size_t)(idx + 1) * FLASH_BLOCK);
+		f.push_back((uint8_t)crc);
+		f.push_back((uint8_t)(crc >> 8));
+
+		if (fault && !fault(idx, f)) return false;
+		put(f.data(), f.size());
+		return true;
+	}
+};
+
+/* -------------------------------------------------------------------------- */
+
+// the engine on the device side of the pty, in its own thread
+struct device
+{
+	std::thread       thr;
+	std::atomic<bool> run { false };
+
+	void start( void )
+	{
+		rec_init();
+		fwu_init();
+		run = true;
+		thr = std::thread([this] { while (run) { fwu_poll(); std::this_thread::sleep_for(microseconds(50)); } });
+	}
+
+	void stop( void )
+	{
+		run = false;
+		thr.join();
+	}
+
+	// power cycle: RAM state and pending input are lost, flash and EEPROM kept
+	void reboot( void )
+	{
+		uint8_t c;
+		stop();
+		while (uart_getc(&c));
+		start();
+	}
+};
+
+/* -------------------------------------------------------------------------- */
+
+static int errors;
+
+static void expect( bool ok, const char *what )
+{
+	printf("fwu: %-48s %s\n", what, ok ? "ok" : "FAILED");
+	if (!ok) errors++;
+}
+
+static std::vector<uint8_t> image( uint16_t blocks, uint8_t seed )
+{
+	std::vector<uint8_t> img((size_t)blocks * FLASH_BLOCK - 37); // a partial last block
+	for (size_t i = 0; i < img.size(); i++) img[i] = (uint8_t)(i * 7 + seed + (i >> 7));
+	return img;
+}
+
+static bool flashed( const std::vector<uint8_t> &img )
+{
+	return memcmp(flash_mem, img.data(), img.size()) == 0 && fwu.done;
+}
+
+static int loopback( void )
+{
+	int master = posix_openpt(O_RDWR | O_NOCTTY);
+	struct termios tio;
+
+	if (master < 0 || grantpt(master) || unlockpt(master)) { perror("pty"); return 1; }
+	uart_fd = open(ptsname(master), O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (uart_fd < 0) { perror("pty"); return 1; }
+	tcgetattr(uart_fd, &tio);
+	cfmakeraw(&tio);
+	tcsetattr(uart_fd, TCSANOW, &tio);
+
+	device dev;
+	dev.start();
+
+	{	// 37 blocks, the last window is partial
+		fwu_sender s(master);
+		std::vector<uint8_t> img = image(37, 1);
+		memset(flash_mem, 0, sizeof(flash_mem));
+		expect(s.send(img, 1) && flashed(img) && s.resumed == 0 && s.nacks == 0, "clean transfer");
+	}
+	{	// a bad block crc is NACKed and resent
+		fwu_sender s(master);
+		std::vector<uint8_t> img = image(24, 2);
+		bool once = true;
+		s.fault = [&]( uint16_t idx, std::vector<uint8_t> &f ) { if (idx == 5 && once) { f[40] ^= 1; once = false; } return true; };
+		memset(flash_mem, 0, sizeof(flash_mem));
+		expect(s.send(img, 2) && flashed(img) && s.nacks == 1, "bad block: NACK and resend");
+	}
+	{	// a block lost out of order is NACKed (the window is resent from it)
+		fwu_sender s(master);
+		std::vector<uint8_t> img = image(24, 3);
+		bool once = true;
+		s.fault = [&]( uint16_t idx, std::vector<uint8_t> &f ) { if (idx == 8 && once) { f.clear(); once = false; } return true; };
+		memset(flash_mem, 0, sizeof(flash_mem));
+		expect(s.send(img, 3) && flashed(img) && s.nacks == 1, "lost block: NACK and resend");
+	}
+	{	// a broken frame is dropped by the parser timeout
+		fwu_sender s(master);
+		std::vector<uint8_t> img = image(24, 4);
+		bool once = true;
+		s.fault = [&]( uint16_t idx, std::vector<uint8_t> &f ) { if (idx == 11 && once) { f.resize(40); once = false; } return true; };
+		memset(flash_mem, 0, sizeof(flash_mem));
+		expect(s.send(img, 4) && flashed(img), "broken frame: resync and resend");
+	}
+	{	// a programming failure is NACKed and the window resent
+		fwu_sender s(master);
+		std::vector<uint8_t> img = image(24, 5);
+		bool once = true;
+		s.fault = [&]( uint16_t idx, std::vector<uint8_t> & ) { if (idx == 13 && once) { flash_fail = 1; once = false; } return true; };
+		memset(flash_mem, 0, sizeof(flash_mem));
+		expect(s.send(img, 5) && flashed(img) && s.nacks >= 1, "flash failure: NACK and resend");
+	}
+	{	// the host goes away in the middle of block 21, the device reboots,
+		// a new session resumes from the last programmed window
+		std::vector<uint8_t> img = image(40, 6);
+		fwu_sender s1(master), s2(master);
+		s1.fault = [&]( uint16_t idx, std::vector<uint8_t> &f ) { if (idx == 21) { f.resize(60); write(master, f.data(), f.size()); return false; } return true; };
+		memset(flash_mem, 0, sizeof(flash_mem));
+		bool first = !s1.send(img, 6);
+		dev.reboot();
+		expect(first && s2.send(img, 6) && flashed(img) && s2.resumed == 20, "interrupted transfer resumes from block 20");
+	}
+	{	// the device reboots in the middle of a window, the sender recovers
+		fwu_sender s(master);
+		std::vector<uint8_t> img = image(30, 7);
+		bool once = true;
+		s.fault = [&]( uint16_t idx, std::vector<uint8_t> &f ) { if (idx == 15 && once) { f.resize(70); write(master, f.data(), f.size()); f.clear(); dev.reboot(); once = false; } return true; };
+		memset(flash_mem, 0, sizeof(flash_mem));
+		expect(s.send(img, 7) && flashed(img) && s.recovers >= 1, "device reboot: recover by query");
+	}
+	{	// another image does not resume the progress of an interrupted one
+		std::vector<uint8_t> img = image(16, 8);
+		fwu_sender s1(master), s2(master);
+		s1.fault = [&]( uint16_t idx, std::vector<uint8_t> & ) { return idx != 9; };
+		memset(flash_mem, 0, sizeof(flash_mem));
+		s1.send(img, 8);
+		dev.reboot();
+		expect(s2.send(img, 9) && flashed(img) && s2.resumed == 0, "new image id restarts from block 0");
+	}
+
+	dev.stop();
+	close(uart_fd);
+	close(master);
+	return errors != 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static int target( const char *port, const char *file, uint16_t id )
+{
+	int fd = open(port, O_RDWR | O_NOCTTY);
+	FILE *f = fopen(file, "rb");
+	struct termios tio;
+	std::vector<uint8_t> img;
+	int c;
+
+	if (fd < 0 || f == nullptr) { perror("fwu"); return 1; }
+	while ((c = fgetc(f)) != EOF) img.push_back((uint8_t)c);
+	fclose(f);
+
+	tcgetattr(fd, &tio);
+	cfmakeraw(&tio);
+	cfsetspeed(&tio, B115200);
+	tcsetattr(fd, TCSANOW, &tio);
+
+	fwu_sender s(fd);
+	bool ok = s.send(img, id);
+	printf("fwu: %zu bytes from block %u, %d NACKs, %d recoveries: %s\n", img.size(), s.resumed, s.nacks, s.recovers, ok ? "verified" : "FAILED");
+	close(fd);
+	return !ok;
+}
+
+int main( int argc, char *argv[] )
+{
+	if (argc == 4)
+		return target(argv[1], argv[2], (uint16_t)strtoul(argv[3], nullptr, 0));
+	return loopback();
+}
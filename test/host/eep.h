@@ -0,0 +1,73 @@
+#ifndef __EEP_H__
+#define __EEP_H__
+
+#include <stdint.h>
+#include <setjmp.h>
+
+// host fake of eep.h: the data EEPROM is an array and every request is
+// written at once, byte by byte
+// a power failure is simulated by eep.cut: when set, it counts the bytes
+// still written; the write that would take it below zero is lost and
+// longjmp(eep.power) returns to the test, as after a reset
+//
+// usage:
+//   EEP();
+//   if (setjmp(eep.power) == 0) { eep.cut = n; ...; eep.cut = -1; }
+
+#define EEP_SIZE         0x0400
+#define EEP_START      ((uintptr_t)eep.mem)
+
+/* -------------------------------------------------------------------------- */
+
+typedef struct __eep_req
+{
+	volatile uint8_t  busy;
+}	eep_req_t;
+
+typedef struct __eep
+{
+	uint8_t  mem[EEP_SIZE];
+	long     cut;    // bytes left before the power failure, -1 if none
+	long     writes; // bytes written
+	jmp_buf  power;
+}	eep_t;
+
+extern eep_t eep;
+
+#define EEP()   eep_t eep = { .mem = {0}, .cut = -1, .writes = 0, .power = {} }
+
+/* -------------------------------------------------------------------------- */
+
+static inline void eep_init( void )
+{
+}
+
+static inline uint8_t eep_write( eep_req_t *req, uint16_t addr, const void *data, uint16_t len )
+{
+	const uint8_t *p = (const uint8_t *)data;
+
+	req->busy = 0;
+	if (addr > EEP_SIZE || len > EEP_SIZE - addr) return 0;
+	while (len--)
+	{
+		if (eep.cut == 0) longjmp(eep.power, 1);
+		if (eep.cut > 0) eep.cut--;
+		eep.mem[addr++] = *p++;
+		eep.writes++;
+	}
+	return 1;
+}
+
+static inline uint8_t eep_busy( eep_req_t *req )
+{
+	return req->busy;
+}
+
+static inline void eep_wait( eep_req_t *req )
+{
+	(void) req;
+}
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__EEP_H__
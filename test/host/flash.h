@@ -0,0 +1,39 @@
+#ifndef __FLASH_H__
+#define __FLASH_H__
+
+#include <stdint.h>
+#include <string.h>
+
+// host fake of flash.h: program memory is an array (flash_mem), addresses
+// are host addresses, so FWU_START must be defined as (uintptr_t)flash_mem
+// flash_fail makes the next programming operations fail
+
+#define FLASH_BLOCK      128
+#define FLASH_SIZE       0x4000
+
+static uint8_t flash_mem[FLASH_SIZE];
+static int     flash_fail;
+
+/* -------------------------------------------------------------------------- */
+
+static inline void flash_init( void )
+{
+}
+
+static inline uint8_t flash_erase( uintptr_t addr )
+{
+	if (flash_fail) { flash_fail--; return 0; }
+	memset((void *)addr, 0, FLASH_BLOCK);
+	return 1;
+}
+
+static inline uint8_t flash_program( uintptr_t addr, const uint8_t *src )
+{
+	if (flash_fail) { flash_fail--; return 0; }
+	memcpy((void *)addr, src, FLASH_BLOCK);
+	return 1;
+}
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__FLASH_H__
@@ -0,0 +1,30 @@
+#ifndef __IRQ_H__
+#define __IRQ_H__
+
+#include <stdint.h>
+#include <pthread.h>
+
+// host fake of irq.h: the critical sections are one recursive mutex shared
+// by the host threads standing for the main program and the handlers
+
+typedef uint8_t irq_t;
+
+static pthread_mutex_t irq_mtx = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+/* -------------------------------------------------------------------------- */
+
+static inline irq_t irq_lock( void )
+{
+	pthread_mutex_lock(&irq_mtx);
+	return 0;
+}
+
+static inline void irq_unlock( irq_t cc )
+{
+	(void) cc;
+	pthread_mutex_unlock(&irq_mtx);
+}
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__IRQ_H__
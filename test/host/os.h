@@ -0,0 +1,50 @@
+#ifndef __OS_H
+#define __OS_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sched.h>
+#include <osconfig.h>
+
+// host fake of the IntrOS api used by the drivers: the system time is the
+// monotonic clock of the host in OS_FREQUENCY ticks, tasks are host threads
+
+#if   OS_TIMER_SIZE == 16
+typedef uint16_t cnt_t;
+#elif OS_TIMER_SIZE == 32
+typedef uint32_t cnt_t;
+#else
+typedef uint64_t cnt_t;
+#endif
+
+#define SEC            ((cnt_t)(OS_FREQUENCY))
+#define MSEC           ((cnt_t)(SEC / 1000))
+
+/* -------------------------------------------------------------------------- */
+
+static inline cnt_t sys_time( void )
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (cnt_t)((uint64_t)ts.tv_sec * (OS_FREQUENCY) + (uint64_t)ts.tv_nsec * (OS_FREQUENCY) / 1000000000UL);
+}
+
+static inline void tsk_yield( void )
+{
+	sched_yield();
+}
+
+static inline void tsk_sleepUntil( cnt_t time )
+{
+	while ((cnt_t)(sys_time() - time) > (cnt_t)((cnt_t)-1 >> 1))
+		sched_yield();
+}
+
+static inline void tsk_delay( cnt_t delay )
+{
+	tsk_sleepUntil((cnt_t)(sys_time() + delay));
+}
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__OS_H
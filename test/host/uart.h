@@ -0,0 +1,50 @@
+#ifndef __UART_H__
+#define __UART_H__
+
+#include <stdint.h>
+#include <unistd.h>
+
+// host fake of uart.h: UART2 is a non-blocking host file descriptor, the
+// device side of a pty in the tests
+//
+// usage:
+//   UART(32, 64);
+//   uart_fd = open(ptsname(master), O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+#define UART( rxsize, txsize ) int uart_fd = -1
+
+extern int uart_fd;
+
+/* -------------------------------------------------------------------------- */
+
+static inline void uart_init( void )
+{
+}
+
+// non-blocking; returns number of bytes queued
+static inline uint8_t uart_write( const void *buf, uint8_t len )
+{
+	ssize_t n = write(uart_fd, buf, len);
+	return n > 0 ? (uint8_t)n : 0;
+}
+
+static inline void uart_putc( uint8_t c )
+{
+	while (uart_write(&c, 1) == 0);
+}
+
+// non-blocking; returns number of bytes read
+static inline uint8_t uart_read( void *buf, uint8_t len )
+{
+	ssize_t n = read(uart_fd, buf, len);
+	return n > 0 ? (uint8_t)n : 0;
+}
+
+static inline uint8_t uart_getc( uint8_t *c )
+{
+	return uart_read(c, 1);
+}
+
+/* -------------------------------------------------------------------------- */
+
+#endif//__UART_H__
@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pid.h>
+
+// PID controller (pid.h): full-scale gains, limits and inputs for every
+// shift and derivative filter constant, built with -fsanitize=undefined, so
+// a signed overflow or a shift of a negative value fails the test; then a
+// closed loop on a first order plant settles on the setpoint
+
+#define SAMPLES          5000
+
+static int errors;
+
+static void expect( int ok, const char *what )
+{
+	printf("pid: %-40s %s\n", what, ok ? "ok" : "FAILED");
+	if (!ok) errors++;
+}
+
+static q15_t input( int n )
+{
+	switch ((n / 53) % 3)
+	{
+	case 0:  return (n / 17) & 1 ? 32767 : -32768;
+	default: return (q15_t)(rand() % 65536 - 32768);
+	}
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void test_limits( void )
+{
+	static const q15_t lim[][2] = { { -32768, 32767 }, { 0, 32767 }, { -32768, 0 }, { -100, 100 } };
+	int ok = 1;
+	uint8_t shift, dk, l;
+	int n;
+
+	for (shift = 0; shift <= 8; shift++)
+	for (dk = 1; dk <= 15; dk++)
+	for (l = 0; l < sizeof(lim) / sizeof(*lim); l++)
+	{
+		pid_ctrl_t pid = _PID_INIT( 32767, 32767, 32767, shift, lim[l][0], lim[l][1], dk );
+		pid_reset(&pid, 0);
+		for (n = 0; n < SAMPLES; n++)
+		{
+			q15_t u = pid_update(&pid, input(n), input(n + 7));
+			if (u < lim[l][0] || u > lim[l][1]) ok = 0;
+			if (pid.integ < pid.imin || pid.integ > pid.imax) ok = 0;
+		}
+	}
+	expect(ok, "full scale, shift 0..8, dk 1..15");
+}
+
+static void test_ilim( void )
+{
+	int ok = 1;
+	uint8_t shift;
+	int32_t lim;
+
+	for (shift = 0; shift <= 8; shift++)
+		for (lim = -32768; lim <= 32767; lim++)
+			if (_PID_ILIM(lim, shift) != (int32_t)((int64_t)lim * 32768 / (1 << shift)))
+				ok = 0;
+	expect(ok, "integral limits");
+}
+
+static_PID(loop, Q15(0.5), Q15(0.05), Q15(0.1), 1, -32768, 32767, 3);
+
+static void test_loop( void )
+{
+	int32_t y = 0; // plant y += (u - y) / 16, Q15
+	q15_t   u = 0;
+	int ok = 1;
+	int n;
+
+	pid_reset(&loop, 0);
+	for (n = 0; n < SAMPLES; n++)
+	{
+		q15_t sp = n < SAMPLES / 2 ? Q15(0.5) : Q15(-0.25);
+		u  = pid_update(&loop, sp, (q15_t)y);
+		y += (u - y) / 16;
+		if (n == SAMPLES / 2 - 1 || n == SAMPLES - 1)
+			if (abs((int)(y - sp)) > 16) ok = 0;
+	}
+	expect(ok, "closed loop settles");
+}
+
+/* -------------------------------------------------------------------------- */
+
+int main( void )
+{
+	srand(1);
+	test_limits();
+	test_ilim();
+	test_loop();
+	return errors != 0;
+}
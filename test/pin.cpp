@@ -0,0 +1,57 @@
+#include <cstdio>
+#include <pin.h>
+
+// pin descriptors (pin.h) in the host build: the C macros and the C++
+// template act on the port memory the same way, and the descriptor
+// properties are compile-time constants
+
+PIN_PORTS();
+
+#define LED_PIN  PIN(GPIOD, 0x01, PIN_LOW)
+#define SEG_PINS PIN(GPIOB, 0xF0, PIN_HIGH)
+
+typedef Pin<GPIOD_BaseAddress, 0x01, PIN_LOW>  Led;
+typedef Pin<GPIOB_BaseAddress, 0xF0, PIN_HIGH> Seg;
+typedef Pin<GPIOE_BaseAddress, 0x20>           Key;
+
+static_assert(Led::port() == GPIOD && Seg::port() == GPIOB, "port");
+static_assert(Led::level(0x01) == 0x00 && Led::level(0x00) == 0x01, "active low level");
+static_assert(Seg::level(0x5A) == 0x50, "group level");
+
+static int errors;
+
+static void expect( bool ok, const char *what )
+{
+	printf("pin: %-40s %s\n", what, ok ? "ok" : "FAILED");
+	if (!ok) errors++;
+}
+
+int main( void )
+{
+	PIN_OUTPUT(LED_PIN);
+	expect(GPIOD->DDR == 0x01 && GPIOD->CR1 == 0x01, "PIN_OUTPUT");
+	PIN_ON(LED_PIN);
+	expect((GPIOD->ODR & 0x01) == 0x00, "PIN_ON, active low");
+	PIN_OFF(LED_PIN);
+	expect((GPIOD->ODR & 0x01) == 0x01, "PIN_OFF, active low");
+	PIN_TOGGLE(LED_PIN);
+	expect((GPIOD->ODR & 0x01) == 0x00, "PIN_TOGGLE");
+
+	GPIOB->ODR = 0x0F;
+	PIN_WRITE(SEG_PINS, 0xA5);
+	expect(GPIOB->ODR == 0xAF, "PIN_WRITE keeps the other pins");
+
+	Led::off();
+	expect((GPIOD->ODR & 0x01) == 0x01, "Pin::off, active low");
+	Led::on();
+	expect((GPIOD->ODR & 0x01) == 0x00, "Pin::on, active low");
+	Seg::write(0x3C);
+	expect(GPIOB->ODR == 0x3F, "Pin::write");
+
+	Key::input();
+	GPIOE->IDR = 0x20;
+	expect(Key::get() == 0x20 && PIN_GET(PIN(GPIOE, 0x20, PIN_LOW)) == 0, "Pin::get, PIN_GET");
+	expect(GPIOE->DDR == 0x00 && GPIOE->CR1 == 0x20, "Pin::input");
+
+	return errors != 0;
+}
@@ -0,0 +1,45 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <prd.h>
+
+// periodic delay (prd.h) on the host clock: a run of periods with one body
+// overrunning three of them, then the histogram report of prd_dump, printed
+// here and checked for the totals
+
+#define WAITS            60
+#define PERIOD           (10 * MSEC)
+
+static_PRD(prd, PERIOD);
+
+static char   out[512];
+static size_t pos;
+
+static void put( const char *s )
+{
+	size_t n = strlen(s);
+	if (pos + n < sizeof(out)) { memcpy(out + pos, s, n); pos += n; out[pos] = 0; }
+}
+
+int main( void )
+{
+	unsigned sum = 0;
+	char line[32];
+	int i, ok;
+
+	for (i = 0; i < WAITS; i++)
+	{
+		prd_wait(prd);
+		if (i == WAITS / 2) tsk_delay(3 * PERIOD + PERIOD / 2);
+	}
+	for (i = 0; i < PRD_BINS; i++) sum += prd->hist[i];
+	ok = sum == WAITS && prd->overrun >= 3; // more if the host is loaded
+	snprintf(line, sizeof(line), "overrun: %u\r\n", prd->overrun);
+
+	prd_dump(prd, put);
+	fputs(out, stdout);
+	ok = ok && strstr(out, "late >= 7: ") && strstr(out, line) && prd->overrun == 0 && prd->hist[0] == 0;
+
+	printf("prd: %-40s %s\n", "histogram and overruns reported", ok ? "ok" : "FAILED");
+	return !ok;
+}
@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <string.h>
+#include <rec.h>
+
+// record store (rec.h) against power failure: a workload of puts and deletes
+// is run with the power cut before every single EEPROM byte write, the store
+// is rebooted and every key must hold either its last written value or, for
+// the put cut short, the new one; then the workload goes on and must end with
+// the model contents; a second cut is made at every write of a recovery
+
+EEP();
+REC();
+
+#define KEYS             12
+#define STEPS            400
+
+typedef struct { uint8_t len; uint8_t data[8]; } val_t;
+
+static val_t   model[KEYS + 1];
+static val_t   pending;
+static uint8_t pendingKey;
+static int     errors;
+
+static void op( int i, uint8_t *key, val_t *v )
+{
+	uint8_t j;
+	*key   = (uint8_t)(i < 4 ? 9 + i : 1 + (i * 7) % 8); // 9..12 written once, copied by every compaction
+	v->len = (i % 17 == 16) ? 0 : (uint8_t)(1 + (i * 5) % 8);
+	for (j = 0; j < v->len; j++) v->data[j] = (uint8_t)(i + j * 31);
+}
+
+static int same( const val_t *v, const uint8_t *data, uint8_t len )
+{
+	if (data == 0) return v->len == 0;
+	return v->len == len && memcmp(v->data, data, len) == 0;
+}
+
+// compare the store with the model (the pending put may have landed or not),
+// then take the store contents as the model
+static void check( long c1, long c2, const char *when )
+{
+	uint8_t key, len = 0;
+
+	for (key = 1; key <= KEYS; key++)
+	{
+		const uint8_t *data = rec_get(key, &len);
+		if (same(&model[key], data, len)) continue;
+		if (key == pendingKey && same(&pending, data, len)) { model[key] = pending; continue; }
+		if (errors++ < 10) printf("cut %ld/%ld %s: key %u lost\n", c1, c2, when, key);
+	}
+	pendingKey = 0;
+}
+
+// returns the bytes written by the recovery after the first cut
+static long run( long c1, long c2 )
+{
+	volatile int  step = 0;
+	volatile int  boot = 0;
+	volatile long recovery = 0;
+	long mark;
+
+	memset(eep.mem, 0, sizeof(eep.mem));
+	memset(model, 0, sizeof(model));
+	pendingKey = 0;
+
+	if (setjmp(eep.power) != 0)
+		boot++;
+
+	eep.cut = boot == 0 ? c1 : boot == 1 ? c2 : -1;
+	memset(&rec, 0, sizeof(rec));
+	mark = eep.writes;
+	rec_init();
+	if (boot == 1) recovery = eep.writes - mark;
+	if (boot) check(c1, c2, "boot");
+
+	for (; step < STEPS; step++)
+	{
+		uint8_t key;
+		op(step, &key, &pending);
+		pendingKey = key;
+		if (!rec_put(key, pending.data, pending.len) && errors++ < 10)
+			printf("cut %ld/%ld: store full at step %d\n", c1, c2, step);
+		model[key] = pending;
+		pendingKey = 0;
+	}
+
+	eep.cut = -1;
+	memset(&rec, 0, sizeof(rec));
+	rec_init();
+	check(c1, c2, "end");
+	return recovery;
+}
+
+int main( void )
+{
+	long total, c1, c2, runs = 0, recoveries = 0;
+
+	eep.writes = 0;
+	run(-1, -1);
+	total = eep.writes;
+
+	for (c1 = 0; c1 < total; c1++)
+	{
+		long r = run(c1, -1);
+		runs++;
+		if (r) recoveries++;
+		for (c2 = 0; c2 < r; c2++, runs++)
+			run(c1, c2);
+	}
+
+	printf("rec: %ld byte writes, %ld runs, %ld interrupted compactions, %d errors\n", total, runs, recoveries, errors);
+	return errors != 0;
+}
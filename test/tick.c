@@ -0,0 +1,43 @@
+#include <stdio.h>
+#include <tick.h>
+
+// run-time conversions (tick.h) against the exact result for every 16-bit
+// argument: never shorter, longer by at most one
+
+static int errors;
+
+static void check( const char *what, uint32_t num, uint32_t den )
+{
+	uint16_t i = TICK_INT(num, den), f = TICK_FRAC(num, den);
+	uint32_t x, worst = 0;
+
+	for (x = 0; x < 65536; x++)
+	{
+		uint64_t exact = ((uint64_t)x * num + den - 1) / den; // ceil
+		uint16_t y;
+		if (exact >= 65535) break;
+		y = tick_scale((uint16_t)x, i, f);
+		if (y < exact || y > exact + 1)
+		{
+			if (errors++ < 10) printf("tick: %s(%u) = %u, exact %u\n", what, x, y, (unsigned)exact);
+		}
+		if (y - exact > worst) worst = (uint32_t)(y - exact);
+	}
+	printf("tick: %-24s %u/%u: int %u frac 0x%04X, up to +%u\n", what, num, den, i, f, worst);
+}
+
+int main( void )
+{
+	check("tick_ms", OS_FREQUENCY, 1000);
+	check("tick_us", OS_FREQUENCY, 1000000);
+	check("tick_toMs", 1000, OS_FREQUENCY);
+	check("timer_us (psc 1)", CPU_FREQUENCY, 1000000);
+	check("timer_us (psc 3)", CPU_FREQUENCY / 3, 1000000);
+	check("1/3", 1, 3);
+	check("7/1024", 7, 1024);
+	check("32768/1000", 32768, 1000);
+	check("1000/32768", 1000, 32768);
+	check("999999/1000000", 999999, 1000000);
+	check("12345/16000000", 12345, 16000000);
+	return errors != 0;
+}
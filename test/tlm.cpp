@@ -0,0 +1,521 @@
+// telemetry streamer (tlm.h) against the host decoder over a pty
+// the decoder is a pipeline of three threads: the reader takes chunks of the
+// byte stream from the port, the decoder splits them into frames at the zero
+// delimiters, undoes COBS, checks the CRC-16 and the sequence numbers (a gap
+// counts the packets lost, dropped by the device or corrupted on the line),
+// and the writer exports the packets as CSV or binary
+// the test runs tlm.h in a device thread on the slave side of a pty: a long
+// stream with drops when the pool is empty, then the decoder on its own with
+// noise, corrupted and truncated frames, and both export formats
+// with arguments, the decoder records a target (or sstm8) on a serial port or
+// pty until interrupted, to CSV (fields by the formats given per packet type)
+// or, for a file name ending in .bin, to binary:
+//   tlm.test /dev/ttyUSB0 log.csv 1:>hhH 2:>i
+// a format is the byte order ('>' STM8, '<') and b B h H i I f for 8, 16 and
+// 32-bit signed and unsigned integers and float; the bytes past the fields
+// are written in hex; a binary record is seq(1) type(1) len(1) data(len)
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <tlm.h>
+
+UART(0, 0);
+TLM();
+
+using namespace std::chrono;
+
+/* -------------------------------------------------------------------------- */
+
+// blocking queue between the threads of the decoder
+template <class T>
+struct tlm_channel
+{
+	std::mutex              mtx;
+	std::condition_variable cv;
+	std::deque<T>           q;
+	bool                    closed = false;
+
+	void push( T &&v )
+	{
+		{ std::lock_guard<std::mutex> l(mtx); q.push_back(std::move(v)); }
+		cv.notify_one();
+	}
+
+	void close( void )
+	{
+		{ std::lock_guard<std::mutex> l(mtx); closed = true; }
+		cv.notify_all();
+	}
+
+	// false when closed and empty
+	bool pop( T &v )
+	{
+		std::unique_lock<std::mutex> l(mtx);
+		cv.wait(l, [this] { return closed || !q.empty(); });
+		if (q.empty()) return false;
+		v = std::move(q.front());
+		q.pop_front();
+		return true;
+	}
+};
+
+struct tlm_packet
+{
+	uint64_t             idx;  // sequence number extended over its wraps
+	uint8_t              seq;
+	uint8_t              type;
+	std::vector<uint8_t> data;
+};
+
+/* -------------------------------------------------------------------------- */
+
+// frames -> packets, one byte stream in order
+struct tlm_decoder
+{
+	uint64_t packets = 0; // good packets
+	uint64_t lost    = 0; // sequence numbers skipped
+	uint64_t corrupt = 0; // frames failing COBS, length or CRC
+	uint64_t bytes   = 0;
+
+	void feed( const uint8_t *p, size_t n, const std::function<void(tlm_packet &&)> &out )
+	{
+		bytes += n;
+		for (; n; n--, p++)
+		{
+			if (*p != 0) { if (frame.size() < 512) frame.push_back(*p); else over = true; continue; }
+			if (!frame.empty() || over) frame_end(out);
+			frame.clear();
+			over  = false;
+			first = false;
+		}
+	}
+
+private:
+
+	std::vector<uint8_t> frame;
+	std::vector<uint8_t> dec;
+	bool                 first = true; // the stream may start in the middle of a frame
+	bool                 over  = false;
+	bool                 sync  = false;
+	uint64_t             next  = 0;
+
+	bool cobs( void )
+	{
+		size_t i = 0, n = frame.size();
+		dec.clear();
+		while (i < n)
+		{
+			uint8_t code = frame[i];
+			if (i + code > n) return false;
+			dec.insert(dec.end(), frame.begin() + (ptrdiff_t)i + 1, frame.begin() + (ptrdiff_t)(i + code));
+			i += code;
+			if (i < n && code < 0xFF) dec.push_back(0);
+		}
+		return true;
+	}
+
+	void frame_end( const std::function<void(tlm_packet &&)> &out )
+	{
+		if (over || !cobs() || dec.size() < 4 ||
+		    crc16(CRC16_INIT, dec.data(), (uint16_t)(dec.size() - 2)) != (dec[dec.size() - 2] | dec[dec.size() - 1] << 8))
+		{
+			if (!first) corrupt++;
+			return;
+		}
+
+		tlm_packet pkt;
+		pkt.seq  = dec[0];
+		pkt.type = dec[1];
+		pkt.data.assign(dec.begin() + 2, dec.end() - 2);
+		if (sync)
+		{
+			uint8_t gap = (uint8_t)(pkt.seq - (uint8_t)next); // up to 255 in a row
+			lost += gap;
+			next += gap;
+		}
+		else
+		{
+			next = pkt.seq;
+			sync = true;
+		}
+		pkt.idx = next++;
+		packets++;
+		out(std::move(pkt));
+	}
+};
+
+/* -------------------------------------------------------------------------- */
+
+// packet export
+struct tlm_export
+{
+	virtual ~tlm_export() {}
+	virtual void put( const tlm_packet &pkt ) = 0;
+};
+
+// seq,type,fields: the fields by the format of the type, then the rest in hex
+struct tlm_csv : tlm_export
+{
+	FILE                         *f;
+	std::map<uint8_t, std::string> fmt;
+
+	tlm_csv( FILE *f, const std::map<uint8_t, std::string> &fmt ) : f(f), fmt(fmt) {}
+
+	void put( const tlm_packet &pkt ) override
+	{
+		auto   it  = fmt.find(pkt.type);
+		size_t pos = 0;
+		bool   big = true;
+
+		fprintf(f, "%llu,%u", (unsigned long long)pkt.idx, pkt.type);
+		if (it != fmt.end())
+		{
+			for (char c : it->second)
+			{
+				size_t   len = c == 'b' || c == 'B' ? 1 : c == 'h' || c == 'H' ? 2 : c == 'i' || c == 'I' || c == 'f' ? 4 : 0;
+				uint32_t v   = 0;
+				if (c == '>' || c == '<') { big = c == '>'; continue; }
+				if (len == 0 || pos + len > pkt.data.size()) break;
+				for (size_t i = 0; i < len; i++)
+					v |= (uint32_t)pkt.data[pos + i] << (8 * (big ? len - 1 - i : i));
+				pos += len;
+				switch (c)
+				{
+				case 'b': fprintf(f, ",%d", (int8_t)v);  break;
+				case 'h': fprintf(f, ",%d", (int16_t)v); break;
+				case 'i': fprintf(f, ",%d", (int32_t)v); break;
+				case 'f': { float x; memcpy(&x, &v, 4); fprintf(f, ",%g", x); break; }
+				default:  fprintf(f, ",%u", v);          break;
+				}
+			}
+		}
+		if (pos < pkt.data.size())
+		{
+			fputc(',', f);
+			for (; pos < pkt.data.size(); pos++) fprintf(f, "%02X", pkt.data[pos]);
+		}
+		fputc('\n', f);
+	}
+};
+
+// seq(1) type(1) len(1) data(len)
+struct tlm_bin : tlm_export
+{
+	FILE *f;
+
+	explicit tlm_bin( FILE *f ) : f(f) {}
+
+	void put( const tlm_packet &pkt ) override
+	{
+		uint8_t hdr[3] = { pkt.seq, pkt.type, (uint8_t)pkt.data.size() };
+		fwrite(hdr, 1, sizeof(hdr), f);
+		fwrite(pkt.data.data(), 1, pkt.data.size(), f);
+	}
+};
+
+/* -------------------------------------------------------------------------- */
+
+// reader -> decoder -> writer, each in its own thread
+struct tlm_pipeline
+{
+	tlm_decoder       dec;
+	std::atomic<bool> run { false };
+
+	tlm_pipeline( int fd, tlm_export &out ) : fd(fd), out(out) {}
+
+	void start( void )
+	{
+		run    = true;
+		reader = std::thread([this] { read_loop(); });
+		decode = std::thread([this] { decode_loop(); });
+		writer = std::thread([this] { write_loop(); });
+	}
+
+	// stop when the port has been quiet for (ms), then drain the pipeline
+	void stop( int ms )
+	{
+		while (since_data() < ms) std::this_thread::sleep_for(milliseconds(1));
+		run = false;
+		reader.join();
+		decode.join();
+		writer.join();
+	}
+
+private:
+
+	int               fd;
+	tlm_export       &out;
+	std::thread       reader, decode, writer;
+	std::atomic<long> last { 0 };
+
+	tlm_channel<std::vector<uint8_t>> chunks;
+	tlm_channel<tlm_packet>           packets;
+
+	static long now( void )
+	{
+		return (long)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+	}
+
+	long since_data( void ) { return now() - last; }
+
+	void read_loop( void )
+	{
+		uint8_t buf[4096];
+		last = now();
+		while (run)
+		{
+			struct pollfd pfd = { fd, POLLIN, 0 };
+			if (poll(&pfd, 1, 10) <= 0) continue;
+			ssize_t n = read(fd, buf, sizeof(buf));
+			if (n <= 0) continue;
+			chunks.push(std::vector<uint8_t>(buf, buf + n));
+			last = now();
+		}
+		chunks.close();
+	}
+
+	void decode_loop( void )
+	{
+		std::vector<uint8_t> c;
+		while (chunks.pop(c))
+			dec.feed(c.data(), c.size(), [this]( tlm_packet &&p ) { packets.push(std::move(p)); });
+		packets.close();
+	}
+
+	void write_loop( void )
+	{
+		tlm_packet p;
+		while (packets.pop(p))
+			out.put(p);
+	}
+};
+
+/* -------------------------------------------------------------------------- */
+
+static int errors;
+
+static void expect( bool ok, const char *what )
+{
+	printf("tlm: %-48s %s\n", what, ok ? "ok" : "FAILED");
+	if (!ok) errors++;
+}
+
+// collects the packets for the checks
+struct tlm_keep : tlm_export
+{
+	std::vector<tlm_packet> pkts;
+	void put( const tlm_packet &pkt ) override { pkts.push_back(pkt); }
+};
+
+// data of the packet (i): sizes 0..TLM_SIZE, zero bytes included
+static std::vector<uint8_t> sample( uint32_t i )
+{
+	std::vector<uint8_t> d(i % (TLM_SIZE + 1));
+	for (size_t j = 0; j < d.size(); j++) d[j] = (uint8_t)((i * 31 + j * 7) % 5 == 0 ? 0 : i + j);
+	return d;
+}
+
+// encoded frame of a packet, made by tlm.h itself
+static std::vector<uint8_t> frame( uint8_t type, const std::vector<uint8_t> &d )
+{
+	tlm_slot_t *s = tlm_begin(type);
+	std::vector<uint8_t> f;
+	uint8_t i;
+	tlm_put(s, d.data(), (uint8_t)d.size());
+	tlm_end(s);
+	f.assign(s->buf, s->buf + s->len);
+	while (ring_get(tlm_q, &i)); // taken here, not by tlm_poll
+	s->state = TLM_FREE;
+	return f;
+}
+
+static void test_stream( int master )
+{
+	const uint32_t COUNT = 30000;
+	uint32_t drops = 0;
+	uint8_t  seq0  = tlm.seq;
+	tlm_keep keep;
+	tlm_pipeline pipe(master, keep);
+
+	pipe.start();
+	std::thread dev([&] {
+		uint32_t burst = 0;
+		for (uint32_t i = 0; i < COUNT; i++)
+		{
+			std::vector<uint8_t> d = sample(i);
+			tlm_slot_t *s = burst < 200 ? tlm_begin((uint8_t)(i % 3)) : nullptr;
+			if (s == nullptr)
+			{
+				if (burst < 200) { drops++; burst++; i--; } // the packet is lost, a new one follows
+				else             { burst = 0; i--; while (!ring_empty(tlm_q)) { tlm_poll(); std::this_thread::yield(); } }
+				tlm_poll();
+				continue;
+			}
+			burst = 0;
+			tlm_put(s, d.data(), (uint8_t)d.size());
+			tlm_end(s);
+			tlm_poll();
+		}
+		while (tlm.cur || !ring_empty(tlm_q)) { tlm_poll(); std::this_thread::yield(); }
+	});
+	dev.join();
+	pipe.stop(50);
+
+	// every packet arrives in order, the sequence numbers of the dropped ones are the gaps
+	bool ok = keep.pkts.size() == COUNT && pipe.dec.lost == drops && pipe.dec.corrupt == 0 &&
+	          keep.pkts[0].seq == seq0 && keep.pkts.back().idx - keep.pkts[0].idx == COUNT - 1 + drops;
+	for (size_t k = 0; ok && k < keep.pkts.size(); k++)
+		ok = keep.pkts[k].type == k % 3 && keep.pkts[k].data == sample((uint32_t)k);
+	printf("tlm: %u packets, %u dropped by the device, %llu bytes\n", COUNT, drops, (unsigned long long)pipe.dec.bytes);
+	expect(ok, "stream over a pty, drops counted from the gaps");
+}
+
+static void test_decoder( void )
+{
+	tlm_decoder dec;
+	tlm_keep    keep;
+	std::vector<uint8_t> s, f;
+	auto out = [&]( tlm_packet &&p ) { keep.pkts.push_back(p); };
+
+	tlm.seq = 250;
+	s = { 0x12, 0x34, 0x00 };                                        // the tail of a frame: sync, not counted
+	for (uint32_t i = 0; i < 10; i++)
+	{
+		f = frame(7, sample(i + 40));
+		if (i == 3) f[5] ^= 0x40;                                      // corrupted: CRC
+		if (i == 5) f.resize(f.size() / 2), f.push_back(0);            // truncated
+		if (i == 7) s.push_back(0);                                    // an empty frame is ignored
+		s.insert(s.end(), f.begin(), f.end());
+	}
+	for (size_t i = 0; i < s.size(); i += 3)                           // in chunks split anywhere
+		dec.feed(&s[i], std::min<size_t>(3, s.size() - i), out);
+
+	bool ok = dec.packets == 8 && dec.corrupt == 2 && dec.lost == 2 && keep.pkts.size() == 8;
+	for (size_t k = 0, i = 0; ok && k < keep.pkts.size(); k++, i++)
+	{
+		if (i == 3 || i == 5) i++;
+		ok = keep.pkts[k].seq == (uint8_t)(250 + i) && keep.pkts[k].idx == 250 + i && keep.pkts[k].data == sample((uint32_t)i + 40);
+	}
+	expect(ok, "noise, corrupted and truncated frames, wrap");
+}
+
+static void test_export( void )
+{
+	tlm_decoder dec;
+	std::vector<uint8_t> s, f;
+	char  *buf = nullptr;
+	size_t len = 0;
+	FILE  *m;
+
+	tlm.seq = 0;
+	f = frame(1, { 0xFF, 0xFE, 0x12, 0x34, 0x00, 0x00, 0x80, 0x00, 0x3F, 0x80, 0x00, 0x00, 0xAA }); s.insert(s.end(), f.begin(), f.end());
+	f = frame(2, { 0x01, 0x00, 0xFF, 0xFF, 0xFF, 0x7F });                                           s.insert(s.end(), f.begin(), f.end());
+	f = frame(9, { 0x00, 0x01 });                                                                   s.insert(s.end(), f.begin(), f.end());
+
+	m = open_memstream(&buf, &len);
+	{
+		tlm_csv csv(m, { { 1, ">hHif" }, { 2, "<Hi" } });
+		dec.feed(s.data(), s.size(), [&]( tlm_packet &&p ) { csv.put(p); });
+	}
+	fclose(m);
+	expect(std::string(buf, len) == "0,1,-2,4660,32768,1,AA\n1,2,1,2147483647\n2,9,0001\n", "CSV export");
+	free(buf);
+
+	m = open_memstream(&buf, &len);
+	{
+		tlm_decoder d2;
+		tlm_bin bin(m);
+		d2.feed(s.data(), s.size(), [&]( tlm_packet &&p ) { bin.put(p); });
+	}
+	fclose(m);
+	const uint8_t b[] = { 0, 1, 13, 0xFF, 0xFE, 0x12, 0x34, 0x00, 0x00, 0x80, 0x00, 0x3F, 0x80, 0x00, 0x00, 0xAA,
+	                      1, 2, 6, 0x01, 0x00, 0xFF, 0xFF, 0xFF, 0x7F,
+	                      2, 9, 2, 0x00, 0x01 };
+	expect(len == sizeof(b) && memcmp(buf, b, len) == 0, "binary export");
+	free(buf);
+}
+
+static int loopback( void )
+{
+	int master = posix_openpt(O_RDWR | O_NOCTTY);
+	struct termios tio;
+
+	if (master < 0 || grantpt(master) || unlockpt(master)) { perror("pty"); return 1; }
+	uart_fd = open(ptsname(master), O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (uart_fd < 0) { perror("pty"); return 1; }
+	tcgetattr(uart_fd, &tio);
+	cfmakeraw(&tio);
+	tcsetattr(uart_fd, TCSANOW, &tio);
+
+	test_stream(master);
+	test_decoder();
+	test_export();
+
+	close(uart_fd);
+	close(master);
+	return errors != 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static volatile sig_atomic_t quit;
+
+static int target( int argc, char *argv[] )
+{
+	int fd = open(argv[1], O_RDWR | O_NOCTTY);
+	std::string name(argv[2]);
+	bool bin = name.size() > 4 && name.compare(name.size() - 4, 4, ".bin") == 0;
+	FILE *f = fopen(argv[2], bin ? "wb" : "w");
+	std::map<uint8_t, std::string> fmt;
+	struct termios tio;
+
+	if (fd < 0 || f == nullptr) { perror("tlm"); return 1; }
+	for (int i = 3; i < argc; i++)
+	{
+		char *colon = strchr(argv[i], ':');
+		if (colon) fmt[(uint8_t)strtoul(argv[i], nullptr, 0)] = colon + 1;
+	}
+
+	tcgetattr(fd, &tio);
+	cfmakeraw(&tio);
+	cfsetspeed(&tio, B115200);
+	tcsetattr(fd, TCSANOW, &tio);
+
+	tlm_csv csv(f, fmt);
+	tlm_bin raw(f);
+	tlm_pipeline pipe(fd, bin ? (tlm_export &)raw : (tlm_export &)csv);
+	signal(SIGINT, []( int ) { quit = 1; });
+	pipe.start();
+	while (!quit) std::this_thread::sleep_for(milliseconds(100));
+	pipe.stop(0);
+
+	printf("tlm: %llu packets, %llu lost, %llu corrupt, %llu bytes\n", (unsigned long long)pipe.dec.packets,
+	       (unsigned long long)pipe.dec.lost, (unsigned long long)pipe.dec.corrupt, (unsigned long long)pipe.dec.bytes);
+	fclose(f);
+	close(fd);
+	return 0;
+}
+
+int main( int argc, char *argv[] )
+{
+	if (argc >= 3)
+		return target(argc, argv);
+	return loopback();
+}